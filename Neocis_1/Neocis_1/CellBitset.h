@@ -0,0 +1,101 @@
+#ifndef __CELL_BITSET_H__
+#define __CELL_BITSET_H__
+// A bit-packed set of grid cells, one bit per cell, stored in 64 bit words.
+// Bits past the last cell are always zero, so words can be compared and counted directly
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Parallel.h"
+
+class CellBitset {
+public:
+	CellBitset(size_t size = 0) { resize(size); }
+
+	// Resizing clears all bits
+	void resize(size_t size) {
+		bits = size;
+		data.assign((size + 63) / 64, 0);
+	}
+
+	size_t size() const { return bits; }
+
+	void set(size_t index)        { data[index >> 6] |=  (uint64_t{ 1 } << (index & 63)); }
+	void reset(size_t index)      { data[index >> 6] &= ~(uint64_t{ 1 } << (index & 63)); }
+	bool test(size_t index) const { return (data[index >> 6] >> (index & 63)) & 1; }
+
+	void clear() { std::fill(data.begin(), data.end(), 0); }
+
+	size_t count() const {
+		size_t result{ 0 };
+		for (auto word : data) {
+			result += std::bitset<64>(word).count();
+		}
+
+		return result;
+	}
+
+	const uint64_t* words() const { return data.data(); }
+	uint64_t* words() { return data.data(); }
+	size_t wordCount() const { return data.size(); }
+
+	// Replaces the contents with size bits copied from words
+	void assign(const uint64_t* words, size_t size) {
+		resize(size);
+		std::memcpy(data.data(), words, data.size() * sizeof(uint64_t));
+		clearPadding();
+	}
+
+	// Word-parallel set operations; both sets must be the same size.
+	// These are simple loops over whole words, which the compiler vectorizes
+	CellBitset& operator&=(const CellBitset& other) {
+		for (size_t i = 0; i < data.size(); ++i) {
+			data[i] &= other.data[i];
+		}
+
+		return *this;
+	}
+
+	CellBitset& operator|=(const CellBitset& other) {
+		for (size_t i = 0; i < data.size(); ++i) {
+			data[i] |= other.data[i];
+		}
+
+		return *this;
+	}
+
+	// Removes the cells of other
+	CellBitset& andNot(const CellBitset& other) {
+		for (size_t i = 0; i < data.size(); ++i) {
+			data[i] &= ~other.data[i];
+		}
+
+		return *this;
+	}
+
+	// Calls function(index) for every set bit, in increasing order
+	template <typename Function>
+	void forEach(Function function) const {
+		for (size_t i = 0; i < data.size(); ++i) {
+			uint64_t word = data[i];
+			while (word) {
+				function(i * 64 + lowestSetBit(word));
+				word &= word - 1;
+			}
+		}
+	}
+
+private:
+	void clearPadding() {
+		if (bits & 63) {
+			data.back() &= (uint64_t{ 1 } << (bits & 63)) - 1;
+		}
+	}
+
+	size_t bits;
+	std::vector<uint64_t> data;
+};
+
+#endif
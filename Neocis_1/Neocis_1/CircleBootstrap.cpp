@@ -0,0 +1,165 @@
+#include "CircleBootstrap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "CircleMoments.h"
+#include "Parallel.h"
+
+constexpr double CircleBootstrap::DEFAULT_CONFIDENCE;
+
+// SplitMix64: a small, fast generator with good statistical quality.  Drawing the indices is most of the cost of a
+// replicate, and each 64 bit output gives two indices, so this is about twice as fast as std::mt19937
+class SplitMix64 {
+public:
+	explicit SplitMix64(uint64_t seed) : state{ seed } {}
+
+	uint64_t operator()() {
+		uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+
+		return z ^ (z >> 31);
+	}
+
+private:
+	uint64_t state;
+};
+
+CircleBootstrap::CircleBootstrap(int replicates, double confidence, unsigned int threads) :
+	replicates{ std::max(replicates, 1) },
+	confidence{ confidence },
+	threads{ threadCount(threads) },
+	seed{ 0x4e656f636973ull }
+{
+}
+
+// The replicates are split evenly over the threads.  Each thread has its own random stream (seeded from the seed and the
+// thread number) and writes its results to its own range of the output arrays, so no synchronization is needed
+bool CircleBootstrap::run(const std::vector<Point>& points, BootstrapResult& result) const {
+	if (points.size() < 3) {
+		return false;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<double> centresX(replicates);
+	std::vector<double> centresY(replicates);
+	std::vector<double> radii(replicates);
+
+	parallelFor(threads, replicates, [&](unsigned int thread, int first, int last) {
+		runReplicates(points, first, last, thread, centresX, centresY, radii);
+	});
+
+	// Remove failed replicates (marked by a NaN radius)
+	int valid{ 0 };
+	for (int i = 0; i < replicates; ++i) {
+		if (!std::isnan(radii[i])) {
+			centresX[valid] = centresX[i];
+			centresY[valid] = centresY[i];
+			radii[valid] = radii[i];
+			++valid;
+		}
+	}
+
+	if (valid == 0) {
+		return false;
+	}
+
+	result.replicates = valid;
+
+	// Mean and covariance of the centres
+	double meanX{ 0.0 };
+	double meanY{ 0.0 };
+	for (int i = 0; i < valid; ++i) {
+		meanX += centresX[i];
+		meanY += centresY[i];
+	}
+	meanX /= valid;
+	meanY /= valid;
+
+	double cxx{ 0.0 };
+	double cxy{ 0.0 };
+	double cyy{ 0.0 };
+	for (int i = 0; i < valid; ++i) {
+		double dx = centresX[i] - meanX;
+		double dy = centresY[i] - meanY;
+
+		cxx += dx * dx;
+		cxy += dx * dy;
+		cyy += dy * dy;
+	}
+
+	double denominator = std::max(valid - 1, 1);
+	result.meanCentre = Point(meanX, meanY);
+	result.covarianceXX = cxx / denominator;
+	result.covarianceXY = cxy / denominator;
+	result.covarianceYY = cyy / denominator;
+
+	// The confidence region of a 2D normal is an ellipse, whose axes are the eigenvectors of the covariance, scaled by the
+	// chi-square quantile with 2 degrees of freedom (which has the closed form -2 ln(1 - confidence))
+	double quantile = -2.0 * log(1.0 - confidence);
+
+	double halfTrace = (result.covarianceXX + result.covarianceYY) / 2.0;
+	double halfDifference = (result.covarianceXX - result.covarianceYY) / 2.0;
+	double root = sqrt(halfDifference * halfDifference + result.covarianceXY * result.covarianceXY);
+
+	result.centreEllipse.centreX = meanX;
+	result.centreEllipse.centreY = meanY;
+	result.centreEllipse.a = sqrt(std::max(halfTrace + root, 0.0) * quantile);
+	result.centreEllipse.b = sqrt(std::max(halfTrace - root, 0.0) * quantile);
+	result.centreEllipse.angle = atan2(2.0 * result.covarianceXY, result.covarianceXX - result.covarianceYY) / 2.0;
+
+	// Percentile interval of the radius
+	int low  = static_cast<int>(std::floor((1.0 - confidence) / 2.0 * (valid - 1)));
+	int high = static_cast<int>(std::ceil ((1.0 + confidence) / 2.0 * (valid - 1)));
+
+	std::nth_element(radii.begin(), radii.begin() + low, radii.begin() + valid);
+	result.radiusLow = radii[low];
+
+	std::nth_element(radii.begin(), radii.begin() + high, radii.begin() + valid);
+	result.radiusHigh = radii[high];
+
+	result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	return true;
+}
+
+void CircleBootstrap::runReplicates(const std::vector<Point>& points, int first, int last, unsigned int stream,
+	std::vector<double>& centresX, std::vector<double>& centresY, std::vector<double>& radii) const
+{
+	// Each stream starts from a hash of the seed and stream number, so streams start far apart
+	uint64_t streamSeed = SplitMix64(seed ^ SplitMix64(stream)())();
+	SplitMix64 generator(streamSeed);
+
+	const uint64_t n = points.size();
+	const uint64_t MASK{ 0xffffffff };
+
+	for (int replicate = first; replicate < last; ++replicate) {
+		CircleMoments<double> moments;
+
+		for (uint64_t i = 0; i < n; i += 2) {
+			// Each 32 bit half of a random number is mapped to [0, n) with a multiply and shift (much faster than a division)
+			uint64_t random = generator();
+
+			uint64_t index = ((random & MASK) * n) >> 32;
+			moments.add(points[index].x(), points[index].y());
+
+			if (i + 1 < n) {
+				index = ((random >> 32) * n) >> 32;
+				moments.add(points[index].x(), points[index].y());
+			}
+		}
+
+		Point centre;
+		double radius;
+		if (kasaSolve(moments.centred(), centre, radius)) {
+			centresX[replicate] = centre.x();
+			centresY[replicate] = centre.y();
+			radii[replicate] = radius;
+		} else {
+			radii[replicate] = std::nan("");
+		}
+	}
+}
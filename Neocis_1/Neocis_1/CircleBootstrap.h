@@ -0,0 +1,57 @@
+#ifndef __CIRCLE_BOOTSTRAP_H__
+#define __CIRCLE_BOOTSTRAP_H__
+// Bootstrap estimate of the uncertainty of Kasa's circle fit.
+// Each replicate fits a circle to n points drawn (with replacement) from the n input points.
+// Points are never copied - replicates draw indices and feed the points straight into the moment accumulator
+
+#include <cstdint>
+#include <vector>
+
+#include "EllipseMoments.h"
+#include "Point.h"
+
+struct BootstrapResult {
+	// Number of replicates that produced a circle
+	int replicates;
+
+	// Mean and covariance of the fitted centres
+	Point meanCentre;
+	double covarianceXX;
+	double covarianceXY;
+	double covarianceYY;
+
+	// Confidence region of the centre
+	FittedEllipse centreEllipse;
+
+	// Confidence interval of the radius
+	double radiusLow;
+	double radiusHigh;
+
+	double milliseconds;
+};
+
+class CircleBootstrap {
+public:
+	// A thread count of 0 uses all available cores
+	CircleBootstrap(int replicates = DEFAULT_REPLICATES, double confidence = DEFAULT_CONFIDENCE, unsigned int threads = 0);
+
+	void setSeed(uint64_t seed) { this->seed = seed; }
+
+	// Returns false if fewer than 3 points are given, or no replicate produced a circle
+	bool run(const std::vector<Point>& points, BootstrapResult& result) const;
+
+	static const int DEFAULT_REPLICATES{ 10000 };
+	static constexpr double DEFAULT_CONFIDENCE{ 0.95 };
+
+private:
+	void runReplicates(const std::vector<Point>& points, int first, int last, unsigned int stream,
+		std::vector<double>& centresX, std::vector<double>& centresY, std::vector<double>& radii) const;
+
+	int replicates;
+	double confidence;
+	unsigned int threads;
+
+	uint64_t seed;
+};
+
+#endif
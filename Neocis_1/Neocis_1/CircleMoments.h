@@ -0,0 +1,281 @@
+#ifndef __CIRCLE_MOMENTS_H__
+#define __CIRCLE_MOMENTS_H__
+// Running moment accumulators for Kasa's circle fit.
+// Points can be added and removed one at a time (O(1) each), so a fit can follow an incremental selection.
+//
+// The accumulator is specialized on the coordinate type:
+//		Integral coordinates (e.g. grid indices) are accumulated exactly in 64 and 128 bit integers
+//		Floating coordinates are accumulated in doubles, relative to the first point added (to limit cancellation)
+//
+// In both cases the centred moments are only formed (and converted to scene units) when the fit is solved
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#include "Int128.h"
+#include "Point.h"
+
+// Moments of a set of points about their mean, divided by the number of points
+struct CentredMoments {
+	int64_t count;
+
+	double meanX;
+	double meanY;
+
+	double mxx;
+	double myy;
+	double mxy;
+	double mxz;		// sum of x * (x^2 + y^2)
+	double myz;		// sum of y * (x^2 + y^2)
+};
+
+//		  Circle fit to a given set of data points (in 2D)
+//
+//		  This is an algebraic fit, disovered and rediscovered by many people.
+//		  One of the earliest publications is due to Kasa:
+//
+//		  I. Kasa, "A curve fitting procedure and its error analysis",
+//		  IEEE Trans. Inst. Meas., Vol. 25, pages 8-14, (1976)
+//
+//		 The method is based on the minimization of the function
+//
+//					 F = sum [(x-a)^2 + (y-b)^2 - R^2]^2
+//
+//		 This is perhaps the simplest and fastest circle fit.
+//
+//		 It works well when data points are sampled along an entire circle
+//		 or a large part of it (at least half circle).
+//
+//		 It does not work well when data points are sampled along a small arc
+//		 of a circle. In that case the method is heavily biased, it returns
+//		 circles that are too often too small.
+//
+//		   Nikolai Chernov  (September 2012)
+//
+//		 The normal equations are solved by Cholesky factorization of the 2x2 moment matrix.
+//		 Returns false if the points are on a straight line
+inline bool kasaSolve(const CentredMoments& moments, Point& centre, double& radius) {
+	const double EPSILON{ 0.00001 };
+
+	double g11 = sqrt(moments.mxx);
+	if (!(g11 >= EPSILON)) {
+		return false;
+	}
+
+	double g12 = moments.mxy / g11;
+	double g22 = sqrt(moments.myy - g12 * g12);
+
+	// Note that this test also catches NaN
+	if (!(g22 >= EPSILON)) {
+		return false;
+	}
+
+	double d1 = moments.mxz / g11;
+	double d2 = (moments.myz - d1 * g12) / g22;
+
+	// Computing paramters of the fitting circle
+	double c = d2 / g22 / 2.0;
+	double b = (d1 - g12 * c) / g11 / 2.0;
+
+	// Asssembling the output
+	centre.setX(b + moments.meanX);
+	centre.setY(c + moments.meanY);
+	radius = sqrt(b * b + c * c + moments.mxx + moments.myy);
+
+	return true;
+}
+
+// Scales centred moments of coordinates u, v to coordinates x = originX + scaleX * u, y = originY + scaleY * v
+// x3, x2y, xy2, y3 are the centred third moments (divided by the count)
+inline void scaleMoments(CentredMoments& moments, double x3, double x2y, double xy2, double y3,
+	double scaleX, double scaleY, double originX, double originY)
+{
+	moments.mxz = scaleX * scaleX * scaleX * x3  + scaleX * scaleY * scaleY * xy2;
+	moments.myz = scaleX * scaleX * scaleY * x2y + scaleY * scaleY * scaleY * y3;
+
+	moments.mxx *= scaleX * scaleX;
+	moments.myy *= scaleY * scaleY;
+	moments.mxy *= scaleX * scaleY;
+
+	moments.meanX = originX + scaleX * moments.meanX;
+	moments.meanY = originY + scaleY * moments.meanY;
+}
+
+// Floating point coordinates
+template <typename T, typename Enable = void>
+class CircleMoments {
+	static_assert(std::is_floating_point<T>::value, "CircleMoments requires an integral or floating point coordinate type");
+
+public:
+	CircleMoments() { clear(); }
+
+	void clear() {
+		n = 0;
+		shiftX = shiftY = 0.0;
+		sx = sy = sxx = syy = sxy = sxxx = sxxy = sxyy = syyy = 0.0;
+	}
+
+	void add(T x, T y) {
+		if (n == 0) {
+			shiftX = x;
+			shiftY = y;
+		}
+
+		accumulate(x - shiftX, y - shiftY, 1.0);
+		++n;
+	}
+
+	void remove(T x, T y) {
+		accumulate(x - shiftX, y - shiftY, -1.0);
+		--n;
+
+		if (n == 0) {
+			clear();
+		}
+	}
+
+	int64_t count() const { return n; }
+
+	CentredMoments centred(double scaleX = 1.0, double scaleY = 1.0, double originX = 0.0, double originY = 0.0) const {
+		CentredMoments moments;
+		moments.count = n;
+
+		double meanX = sx / n;
+		double meanY = sy / n;
+
+		moments.meanX = shiftX + meanX;
+		moments.meanY = shiftY + meanY;
+
+		moments.mxx = sxx / n - meanX * meanX;
+		moments.myy = syy / n - meanY * meanY;
+		moments.mxy = sxy / n - meanX * meanY;
+
+		double x3  = sxxx / n - 3.0 * meanX * sxx / n + 2.0 * meanX * meanX * meanX;
+		double y3  = syyy / n - 3.0 * meanY * syy / n + 2.0 * meanY * meanY * meanY;
+		double x2y = sxxy / n - 2.0 * meanX * sxy / n - meanY * sxx / n + 2.0 * meanX * meanX * meanY;
+		double xy2 = sxyy / n - 2.0 * meanY * sxy / n - meanX * syy / n + 2.0 * meanX * meanY * meanY;
+
+		scaleMoments(moments, x3, x2y, xy2, y3, scaleX, scaleY, originX, originY);
+
+		return moments;
+	}
+
+private:
+	void accumulate(double x, double y, double sign) {
+		double xx = x * x;
+		double yy = y * y;
+
+		sx   += sign * x;
+		sy   += sign * y;
+		sxx  += sign * xx;
+		syy  += sign * yy;
+		sxy  += sign * x * y;
+		sxxx += sign * xx * x;
+		sxxy += sign * xx * y;
+		sxyy += sign * x * yy;
+		syyy += sign * yy * y;
+	}
+
+	int64_t n;
+
+	double shiftX;
+	double shiftY;
+
+	double sx, sy;
+	double sxx, syy, sxy;
+	double sxxx, sxxy, sxyy, syyy;
+};
+
+// Integral coordinates
+// Raw moments are kept exactly (linear and quadratic in 64 bits, cubic in 128 bits), so adding and removing points never drifts.
+// The centred moments are formed exactly in 128 bits before the final conversion to double.
+// Results are exact as long as |coordinate| < 2^20 and count * |coordinate| < 2^42
+template <typename T>
+class CircleMoments<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+public:
+	CircleMoments() { clear(); }
+
+	void clear() {
+		n = 0;
+		sx = sy = sxx = syy = sxy = 0;
+		sxxx = sxxy = sxyy = syyy = Int128{};
+	}
+
+	void add(T x, T y) {
+		accumulate(x, y, 1);
+		++n;
+	}
+
+	void remove(T x, T y) {
+		accumulate(x, y, -1);
+		--n;
+	}
+
+	int64_t count() const { return n; }
+
+	CentredMoments centred(double scaleX = 1.0, double scaleY = 1.0, double originX = 0.0, double originY = 0.0) const {
+		CentredMoments moments;
+		moments.count = n;
+
+		const Int128 N{ n };
+		const Int128 SX{ sx };
+		const Int128 SY{ sy };
+
+		// n   * centred second moments
+		Int128 cxx = N * Int128{ sxx } - SX * SX;
+		Int128 cyy = N * Int128{ syy } - SY * SY;
+		Int128 cxy = N * Int128{ sxy } - SX * SY;
+
+		// n^2 * centred third moments
+		Int128 TWO{ 2 };
+		Int128 THREE{ 3 };
+		Int128 cxxx = N * N * sxxx - THREE * N * SX * Int128{ sxx } + TWO * SX * SX * SX;
+		Int128 cyyy = N * N * syyy - THREE * N * SY * Int128{ syy } + TWO * SY * SY * SY;
+		Int128 cxxy = N * N * sxxy - TWO * N * SX * Int128{ sxy } - N * SY * Int128{ sxx } + TWO * SX * SX * SY;
+		Int128 cxyy = N * N * sxyy - TWO * N * SY * Int128{ sxy } - N * SX * Int128{ syy } + TWO * SX * SY * SY;
+
+		double count = static_cast<double>(n);
+		double countSquared = count * count;
+		double countCubed = countSquared * count;
+
+		moments.meanX = sx / count;
+		moments.meanY = sy / count;
+
+		moments.mxx = cxx.toDouble() / countSquared;
+		moments.myy = cyy.toDouble() / countSquared;
+		moments.mxy = cxy.toDouble() / countSquared;
+
+		scaleMoments(moments,
+			cxxx.toDouble() / countCubed, cxxy.toDouble() / countCubed, cxyy.toDouble() / countCubed, cyyy.toDouble() / countCubed,
+			scaleX, scaleY, originX, originY
+		);
+
+		return moments;
+	}
+
+private:
+	void accumulate(int64_t x, int64_t y, int64_t sign) {
+		int64_t xx = x * x;
+		int64_t yy = y * y;
+
+		sx  += sign * x;
+		sy  += sign * y;
+		sxx += sign * xx;
+		syy += sign * yy;
+		sxy += sign * x * y;
+
+		sxxx += Int128{ sign * xx * x };
+		sxxy += Int128{ sign * xx * y };
+		sxyy += Int128{ sign * x * yy };
+		syyy += Int128{ sign * yy * y };
+	}
+
+	int64_t n;
+
+	int64_t sx, sy;
+	int64_t sxx, syy, sxy;
+	Int128 sxxx, sxxy, sxyy, syyy;
+};
+
+#endif
@@ -0,0 +1,267 @@
+#include "EllipseMoments.h"
+
+#include <cmath>
+
+EllipseMoments::EllipseMoments(double originX, double originY, double scale) :
+	originX{ originX },
+	originY{ originY },
+	scale{ scale }
+{
+	clear();
+}
+
+void EllipseMoments::clear() {
+	n = 0;
+	sums.fill(0.0);
+}
+
+void EllipseMoments::add(double x, double y) {
+	accumulate(x, y, 1.0);
+	++n;
+}
+
+void EllipseMoments::remove(double x, double y) {
+	accumulate(x, y, -1.0);
+	--n;
+}
+
+// The points are processed in groups of 4, with each point of a group summed into its own lane.
+// The lanes are independent, so the compiler can keep them in SIMD registers; they are added together at the end
+void EllipseMoments::add(const std::vector<Point>& points) {
+	const int LANES{ 4 };
+	double lanes[MOMENTS][LANES]{};
+
+	size_t i{ 0 };
+	for (; i + LANES <= points.size(); i += LANES) {
+		double values[LANES][MOMENTS];
+		for (int lane = 0; lane < LANES; ++lane) {
+			monomials((points[i + lane].x() - originX) * scale, (points[i + lane].y() - originY) * scale, values[lane]);
+		}
+
+		for (int moment = 0; moment < MOMENTS; ++moment) {
+			for (int lane = 0; lane < LANES; ++lane) {
+				lanes[moment][lane] += values[lane][moment];
+			}
+		}
+	}
+
+	for (int moment = 0; moment < MOMENTS; ++moment) {
+		sums[moment] += (lanes[moment][0] + lanes[moment][1]) + (lanes[moment][2] + lanes[moment][3]);
+	}
+
+	for (; i < points.size(); ++i) {
+		accumulate(points[i].x(), points[i].y(), 1.0);
+	}
+
+	n += points.size();
+}
+
+void EllipseMoments::accumulate(double x, double y, double sign) {
+	double values[MOMENTS];
+	monomials((x - originX) * scale, (y - originY) * scale, values);
+
+	for (int moment = 0; moment < MOMENTS; ++moment) {
+		sums[moment] += sign * values[moment];
+	}
+}
+
+// Computes x^p * y^q for all p + q <= 4, in moment index order
+void EllipseMoments::monomials(double x, double y, double values[MOMENTS]) {
+	values[0] = 1.0;
+
+	values[1] = x;
+	values[2] = y;
+
+	values[3] = x * x;
+	values[4] = x * y;
+	values[5] = y * y;
+
+	values[6] = values[3] * x;
+	values[7] = values[3] * y;
+	values[8] = values[5] * x;
+	values[9] = values[5] * y;
+
+	values[10] = values[6] * x;
+	values[11] = values[6] * y;
+	values[12] = values[3] * values[5];
+	values[13] = values[9] * x;
+	values[14] = values[9] * y;
+}
+
+// Entry (i, j) of the scatter matrix is the sum of d_i * d_j over all points, where d = [x^2, xy, y^2, x, y, 1].
+// This is a moment of order (p_i + p_j, q_i + q_j)
+Matrix<6, 6> EllipseMoments::scatter() const {
+	const int P[6]{ 2, 1, 0, 1, 0, 0 };
+	const int Q[6]{ 0, 1, 2, 0, 1, 0 };
+
+	Matrix<6, 6> result;
+	for (int i = 0; i < 6; ++i) {
+		for (int j = 0; j < 6; ++j) {
+			result(i, j) = sums[momentIndex(P[i] + P[j], Q[i] + Q[j])];
+		}
+	}
+
+	return result;
+}
+
+// Real roots of x^3 + a * x^2 + b * x + c = 0 (Numerical Recipes, 5.6)
+static int solveCubic(double a, double b, double c, double roots[3]) {
+	const double PI{ 3.14159265358979323846 };
+
+	double q = (a * a - 3.0 * b) / 9.0;
+	double r = (2.0 * a * a * a - 9.0 * a * b + 27.0 * c) / 54.0;
+
+	if (r * r < q * q * q) {
+		double theta = acos(r / sqrt(q * q * q));
+		double s = -2.0 * sqrt(q);
+
+		roots[0] = s * cos(theta / 3.0) - a / 3.0;
+		roots[1] = s * cos((theta + 2.0 * PI) / 3.0) - a / 3.0;
+		roots[2] = s * cos((theta - 2.0 * PI) / 3.0) - a / 3.0;
+
+		return 3;
+	}
+
+	double A = -copysign(cbrt(fabs(r) + sqrt(r * r - q * q * q)), r);
+	double B = (A == 0.0) ? 0.0 : q / A;
+
+	roots[0] = (A + B) - a / 3.0;
+
+	return 1;
+}
+
+// Eigenvector of m for eigenvalue lambda: the null vector of (m - lambda I) is the largest cross product of two of its rows
+static Vector3 eigenvector(const Matrix3& m, double lambda) {
+	Matrix3 shifted = m;
+	for (int i = 0; i < 3; ++i) {
+		shifted(i, i) -= lambda;
+	}
+
+	Vector3 best;
+	double bestNorm{ 0.0 };
+	for (int i = 0; i < 3; ++i) {
+		int r0 = i;
+		int r1 = (i + 1) % 3;
+
+		Vector3 cross;
+		cross(0, 0) = shifted(r0, 1) * shifted(r1, 2) - shifted(r0, 2) * shifted(r1, 1);
+		cross(1, 0) = shifted(r0, 2) * shifted(r1, 0) - shifted(r0, 0) * shifted(r1, 2);
+		cross(2, 0) = shifted(r0, 0) * shifted(r1, 1) - shifted(r0, 1) * shifted(r1, 0);
+
+		double norm = sqrt(cross(0, 0) * cross(0, 0) + cross(1, 0) * cross(1, 0) + cross(2, 0) * cross(2, 0));
+		if (norm > bestNorm) {
+			bestNorm = norm;
+			best = cross * (1.0 / norm);
+		}
+	}
+
+	return best;
+}
+
+// Direct least squares fitting of ellipses
+//
+//		A. Fitzgibbon, M. Pilu, R. Fisher, "Direct least squares fitting of ellipses",
+//		IEEE Trans. PAMI, Vol. 21, pages 476-480, (1999)
+//
+// The conic A x^2 + B xy + C y^2 + D x + E y + F = 0 minimizing the algebraic distance, subject to 4AC - B^2 = 1, is the
+// eigenvector of a generalized 6x6 eigenproblem.  The numerically stable reduction of Halir and Flusser (1998) is used:
+// the scatter matrix is split into 3x3 blocks S1 (quadratic terms), S2 (mixed) and S3 (linear terms), giving the 3x3 problem
+//
+//		C1^-1 (S1 - S2 S3^-1 S2') a1 = lambda a1,		a2 = -S3^-1 S2' a1
+//
+// where a1 = [A, B, C] is the eigenvector satisfying the ellipse constraint and a2 = [D, E, F]
+bool EllipseMoments::solve(FittedEllipse& ellipse) const {
+	if (n < 5) {
+		return false;
+	}
+
+	Matrix<6, 6> S = scatter();
+
+	Matrix3 S1 = S.block<3, 3>(0, 0);
+	Matrix3 S2 = S.block<3, 3>(0, 3);
+	Matrix3 S3 = S.block<3, 3>(3, 3);
+
+	Matrix3 S3Inverse;
+	if (!inverse(S3, S3Inverse)) {
+		return false;
+	}
+
+	Matrix3 T = (S3Inverse * S2.transpose()) * -1.0;
+	Matrix3 reduced = S1 + S2 * T;
+
+	// Multiply by the inverse of the constraint matrix C1 = [0 0 2; 0 -1 0; 2 0 0]
+	Matrix3 M;
+	for (int col = 0; col < 3; ++col) {
+		M(0, col) =  reduced(2, col) / 2.0;
+		M(1, col) = -reduced(1, col);
+		M(2, col) =  reduced(0, col) / 2.0;
+	}
+
+	// Characteristic polynomial of M
+	double trace = M(0, 0) + M(1, 1) + M(2, 2);
+	double minors =
+		M(0, 0) * M(1, 1) - M(0, 1) * M(1, 0) +
+		M(0, 0) * M(2, 2) - M(0, 2) * M(2, 0) +
+		M(1, 1) * M(2, 2) - M(1, 2) * M(2, 1);
+
+	double roots[3];
+	int numberOfRoots = solveCubic(-trace, minors, -determinant(M), roots);
+
+	// Choose the eigenvector that satisfies the ellipse constraint
+	Vector3 a1;
+	double bestConstraint{ 0.0 };
+	for (int i = 0; i < numberOfRoots; ++i) {
+		Vector3 candidate = eigenvector(M, roots[i]);
+		double constraint = 4.0 * candidate(0, 0) * candidate(2, 0) - candidate(1, 0) * candidate(1, 0);
+
+		if (constraint > bestConstraint) {
+			bestConstraint = constraint;
+			a1 = candidate;
+		}
+	}
+
+	if (bestConstraint <= 0.0) {
+		return false;
+	}
+
+	Vector3 a2 = T * a1;
+
+	double A = a1(0, 0);
+	double B = a1(1, 0);
+	double C = a1(2, 0);
+	double D = a2(0, 0);
+	double E = a2(1, 0);
+	double F = a2(2, 0);
+
+	// Centre is where the gradient of the conic vanishes
+	double denominator = 4.0 * A * C - B * B;
+	double u0 = (B * E - 2.0 * C * D) / denominator;
+	double v0 = (B * D - 2.0 * A * E) / denominator;
+
+	// Value of the conic at the centre
+	double F0 = F + (D * u0 + E * v0) / 2.0;
+
+	// The axes are the eigenvectors of the quadratic form [A B/2; B/2 C]
+	double angle = atan2(B, A - C) / 2.0;
+	double cosine = cos(angle);
+	double sine = sin(angle);
+
+	double lambdaA = A * cosine * cosine + B * cosine * sine + C * sine * sine;
+	double lambdaB = A * sine * sine - B * cosine * sine + C * cosine * cosine;
+
+	double aSquared = -F0 / lambdaA;
+	double bSquared = -F0 / lambdaB;
+
+	if (!(aSquared > 0.0) || !(bSquared > 0.0)) {
+		return false;
+	}
+
+	// Undo the normalization
+	ellipse.centreX = originX + u0 / scale;
+	ellipse.centreY = originY + v0 / scale;
+	ellipse.a = sqrt(aSquared) / scale;
+	ellipse.b = sqrt(bSquared) / scale;
+	ellipse.angle = angle;
+
+	return true;
+}
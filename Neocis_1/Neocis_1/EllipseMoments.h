@@ -0,0 +1,61 @@
+#ifndef __ELLIPSE_MOMENTS_H__
+#define __ELLIPSE_MOMENTS_H__
+// Running moment accumulator for a direct least squares ellipse fit.
+// The interface mirrors CircleMoments: points can be added and removed one at a time (O(1) each), or added as a batch
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Matrix.h"
+#include "Point.h"
+
+// An ellipse with semi-axes a and b; the a axis is at angle (in radians, clockwise in scene coordinates) from the x axis
+struct FittedEllipse {
+	double centreX;
+	double centreY;
+	double a;
+	double b;
+	double angle;
+};
+
+class EllipseMoments {
+public:
+	// Points are normalized to (x - originX) * scale, (y - originY) * scale before accumulating, to keep the 4th order moments
+	// well conditioned; origin should be near the middle of the data and scale about 1 / (half its extent)
+	EllipseMoments(double originX = 0.0, double originY = 0.0, double scale = 1.0);
+
+	void clear();
+
+	void add(double x, double y);
+	void remove(double x, double y);
+
+	// Batch version of add
+	void add(const std::vector<Point>& points);
+
+	int64_t count() const { return n; }
+
+	// The 6x6 scatter matrix of the (normalized) design rows [x^2, xy, y^2, x, y, 1]
+	Matrix<6, 6> scatter() const;
+
+	// Returns false if fewer than 5 points have been added, or the points don't define an ellipse
+	bool solve(FittedEllipse& ellipse) const;
+
+	// Number of distinct moments sum(x^p * y^q), p + q <= 4
+	static const int MOMENTS{ 15 };
+
+private:
+	void accumulate(double x, double y, double sign);
+
+	static int momentIndex(int p, int q) { return (p + q) * (p + q + 1) / 2 + q; }
+	static void monomials(double x, double y, double values[MOMENTS]);
+
+	double originX;
+	double originY;
+	double scale;
+
+	int64_t n;
+	std::array<double, MOMENTS> sums;
+};
+
+#endif
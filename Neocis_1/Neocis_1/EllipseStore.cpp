@@ -0,0 +1,152 @@
+#include "EllipseStore.h"
+
+#include <QPen>
+
+#include <algorithm>
+
+EllipseStore::EllipseStore(QGraphicsScene* scene, size_t maxRecords) :
+	scene{ scene },
+	_maxRecords{ std::max(maxRecords, size_t{ 1 }) },
+	compactions{ 0 }
+{
+	records.reserve(_maxRecords);
+}
+
+// Each record produces two graphics items (near and far ellipses)
+void EllipseStore::add(const EllipseRecord& record) {
+	records.push_back(record);
+
+	if (records.size() > _maxRecords) {
+		compact();
+		return;
+	}
+
+	materialize(record.centreX, record.centreY, record.a * record.scaleNear, record.b * record.scaleNear);
+	materialize(record.centreX, record.centreY, record.a * record.scaleFar,  record.b * record.scaleFar);
+}
+
+void EllipseStore::clear() {
+	records.clear();
+	releaseAll();
+}
+
+void EllipseStore::assign(const EllipseRecord* records, size_t count) {
+	this->records.assign(records, records + count);
+
+	if (this->records.size() > _maxRecords) {
+		compact();
+	} else {
+		refresh();
+	}
+}
+
+// Lowering the cap only drops the records over the new cap (not the quarter that compact drops)
+void EllipseStore::setMaxRecords(size_t maxRecords) {
+	_maxRecords = std::max(maxRecords, size_t{ 1 });
+
+	if (records.size() > _maxRecords) {
+		dropOldest(records.size() - _maxRecords);
+	}
+}
+
+EllipseStoreStatistics EllipseStore::statistics() const {
+	EllipseStoreStatistics statistics;
+
+	statistics.records     = records.size();
+	statistics.liveItems   = liveItems.size();
+	statistics.pooledItems = pooledItems.size();
+	statistics.compactions = compactions;
+	statistics.estimatedBytes = records.capacity() * sizeof(EllipseRecord) +
+		(liveItems.capacity() + pooledItems.capacity()) * sizeof(std::unique_ptr<QGraphicsEllipseItem>) +
+		(liveItems.size() + pooledItems.size()) * ITEM_BYTES_ESTIMATE;
+
+	return statistics;
+}
+
+// Drops the oldest records so that the history is back to three quarters of its cap.
+// Dropping a block (rather than one record at a time) means the cost of refreshing the scene is amortized over many adds
+void EllipseStore::compact() {
+	size_t keep = std::max(_maxRecords - _maxRecords / 4, size_t{ 1 });
+	dropOldest(records.size() > keep ? records.size() - keep : 0);
+}
+
+void EllipseStore::dropOldest(size_t count) {
+	records.erase(records.begin(), records.begin() + count);
+
+	++compactions;
+	refresh();
+
+	// The pool never needs more items than can be live at once
+	if (pooledItems.size() > 2 * _maxRecords) {
+		pooledItems.resize(2 * _maxRecords);
+	}
+}
+
+// Returns all items to the pool and re-creates the visible ones from the history
+void EllipseStore::refresh() {
+	releaseAll();
+
+	for (auto& record : records) {
+		materialize(record.centreX, record.centreY, record.a * record.scaleNear, record.b * record.scaleNear);
+		materialize(record.centreX, record.centreY, record.a * record.scaleFar,  record.b * record.scaleFar);
+	}
+}
+
+void EllipseStore::materialize(double centreX, double centreY, double a, double b) {
+	if (!isVisible(centreX, centreY, a, b)) {
+		return;
+	}
+
+	std::unique_ptr<QGraphicsEllipseItem> item;
+	if (pooledItems.empty()) {
+		item = std::make_unique<QGraphicsEllipseItem>();
+
+		QPen pen;
+		pen.setBrush(QBrush(Qt::red));
+		item->setPen(pen);
+	} else {
+		item = std::move(pooledItems.back());
+		pooledItems.pop_back();
+	}
+
+	item->setRect(centreX - a, centreY - b, 2.0 * a, 2.0 * b);
+	scene->addItem(item.get());
+
+	liveItems.emplace_back(std::move(item));
+}
+
+// An ellipse can be seen if its bounding box overlaps the scene, and the scene is not completely inside the ellipse
+// (the ellipse is only drawn as an outline)
+bool EllipseStore::isVisible(double centreX, double centreY, double a, double b) const {
+	QRectF sceneRect = scene->sceneRect();
+	QRectF bounds(centreX - a, centreY - b, 2.0 * a, 2.0 * b);
+
+	if (!sceneRect.intersects(bounds)) {
+		return false;
+	}
+
+	if (a <= 0.0 || b <= 0.0) {
+		return true;
+	}
+
+	const QPointF corners[]{ sceneRect.topLeft(), sceneRect.topRight(), sceneRect.bottomLeft(), sceneRect.bottomRight() };
+	for (auto& corner : corners) {
+		double x = (corner.x() - centreX) / a;
+		double y = (corner.y() - centreY) / b;
+
+		if (x * x + y * y >= 1.0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void EllipseStore::releaseAll() {
+	for (auto& item : liveItems) {
+		scene->removeItem(item.get());
+		pooledItems.emplace_back(std::move(item));
+	}
+
+	liveItems.clear();
+}
@@ -0,0 +1,80 @@
+#ifndef __ELLIPSE_STORE_H__
+#define __ELLIPSE_STORE_H__
+
+#include <QGraphicsEllipseItem>
+#include <QGraphicsScene>
+
+#include <memory>
+#include <vector>
+
+// A compact record of an ellipse drawn in Part 1.
+// The near and far ellipses are the drawn ellipse (semi-axes a and b) scaled by scaleNear and scaleFar
+struct EllipseRecord {
+	double centreX;
+	double centreY;
+	double a;
+	double b;
+	double scaleNear;
+	double scaleFar;
+};
+
+// Records are written to session files as is
+static_assert(sizeof(EllipseRecord) == 6 * sizeof(double), "EllipseRecord must be packed");
+
+struct EllipseStoreStatistics {
+	size_t records;
+	size_t liveItems;
+	size_t pooledItems;
+	size_t compactions;
+
+	// Approximate memory used by the history and the graphics items (see ITEM_BYTES_ESTIMATE)
+	size_t estimatedBytes;
+};
+
+// Keeps the history of drawn ellipses as plain values, and only creates graphics items for ellipses that can be seen.
+// Graphics items are recycled through a pool, and the history is compacted (oldest records dropped) when it exceeds its cap,
+// so memory stays bounded however long the session is.
+class EllipseStore {
+public:
+	EllipseStore(QGraphicsScene* scene, size_t maxRecords = DEFAULT_MAX_RECORDS);
+
+	void add(const EllipseRecord& record);
+	void clear();
+
+	// Replaces the history
+	void assign(const EllipseRecord* records, size_t count);
+
+	void setMaxRecords(size_t maxRecords);
+	size_t maxRecords() const { return _maxRecords; }
+
+	const std::vector<EllipseRecord>& history() const { return records; }
+	EllipseStoreStatistics statistics() const;
+
+	static const size_t DEFAULT_MAX_RECORDS{ 1024 };
+
+	// A graphics item is much larger than sizeof(QGraphicsEllipseItem): its private data (transform, flags, pen and brush)
+	// and its entry in the scene's index are allocated separately.  This is a rough allowance per item
+	static const size_t ITEM_BYTES_ESTIMATE{ 512 };
+
+private:
+	void compact();
+	void dropOldest(size_t count);
+	void refresh();
+
+	void materialize(double centreX, double centreY, double a, double b);
+	bool isVisible(double centreX, double centreY, double a, double b) const;
+
+	void releaseAll();
+
+	QGraphicsScene* scene;
+
+	size_t _maxRecords;
+	size_t compactions;
+
+	std::vector<EllipseRecord> records;
+
+	std::vector<std::unique_ptr<QGraphicsEllipseItem>> liveItems;
+	std::vector<std::unique_ptr<QGraphicsEllipseItem>> pooledItems;
+};
+
+#endif
@@ -0,0 +1,211 @@
+#include "EllipsoidShell.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Parallel.h"
+
+EllipsoidShell::EllipsoidShell(double spacingX, double spacingY, double spacingZ, unsigned int threads) :
+	spacing{ spacingX, spacingY, spacingZ },
+	threads{ threads }
+{
+	this->threads = threadCount(threads);
+}
+
+// Returns the matrix A of the ellipsoid's quadratic form, (p - centre)' A (p - centre) = 1
+static Matrix3 quadraticForm(const Ellipsoid& ellipsoid) {
+	Matrix3 scale;
+	for (int i = 0; i < 3; ++i) {
+		scale(i, i) = 1.0 / (ellipsoid.axes[i] * ellipsoid.axes[i]);
+	}
+
+	return ellipsoid.rotation.transpose() * scale * ellipsoid.rotation;
+}
+
+// This is the 3D version of Part_1::markSquares.
+// The 2D algorithm scans columns and then rows, because a single scan misses points where the curve is nearly parallel
+// to the scan; in 3D the volume is swept along each of the three axes for the same reason.
+//
+// Each sweep works one slice at a time, and slices are split between threads.  The rows of a volume never share words,
+// and each sweep's slices write to disjoint sets of rows, so no locking is needed
+void EllipsoidShell::mark(const Ellipsoid& ellipsoid, VoxelVolume& volume) const {
+	Matrix3 form = quadraticForm(ellipsoid);
+
+	// Lines along x and along y, sliced by z
+	parallelFor(threads, volume.depth(), [&](unsigned int, int first, int last) { sweep(ellipsoid, form, 0, 1, 2, first, last, volume); });
+	parallelFor(threads, volume.depth(), [&](unsigned int, int first, int last) { sweep(ellipsoid, form, 1, 0, 2, first, last, volume); });
+
+	// Lines along z, sliced by y
+	parallelFor(threads, volume.height(), [&](unsigned int, int first, int last) { sweep(ellipsoid, form, 2, 0, 1, first, last, volume); });
+}
+
+// Sweeps lines along axis u.  Lines are indexed by v (within a slice) and w (the slice).
+//
+// With d = p - centre, the points of a line where it crosses the surface satisfy
+//
+//		A_uu * du^2 + 2 * B * du + C - 1 = 0,		B = A_uv * dv + A_uw * dw,		C = A_vv * dv^2 + 2 * A_vw * dv * dw + A_ww * dw^2
+//
+// Within a slice, B is linear and C is quadratic in v, so both are updated incrementally (by forward differences) from
+// one line to the next.  Each crossing marks the voxel nearest to it
+void EllipsoidShell::sweep(const Ellipsoid& ellipsoid, const Matrix3& form, int u, int v, int w, int firstSlice, int lastSlice,
+	VoxelVolume& volume) const
+{
+	const int size[3]{ volume.width(), volume.height(), volume.depth() };
+
+	const double Auu = form(u, u);
+	const double Auv = form(u, v);
+	const double Auw = form(u, w);
+	const double Avv = form(v, v);
+	const double Avw = form(v, w);
+	const double Aww = form(w, w);
+
+	const double stepV = spacing[v];
+	const double stepB = Auv * stepV;
+	const double stepStepC = 2.0 * Avv * stepV * stepV;
+
+	int index[3];
+	for (int slice = firstSlice; slice < lastSlice; ++slice) {
+		index[w] = slice;
+
+		// Start of the slice (line 0)
+		double dw = slice * spacing[w] - ellipsoid.centre[w];
+		double dv = -ellipsoid.centre[v];
+
+		double B = Auv * dv + Auw * dw;
+		double C = Avv * dv * dv + 2.0 * Avw * dv * dw + Aww * dw * dw;
+		double stepC = Avv * (2.0 * dv * stepV + stepV * stepV) + 2.0 * Avw * stepV * dw;
+
+		for (int line = 0; line < size[v]; ++line) {
+			double discriminant = B * B - Auu * (C - 1.0);
+
+			if (discriminant >= 0.0) {
+				index[v] = line;
+
+				double root = sqrt(discriminant);
+				const double crossings[2]{ (-B - root) / Auu, (-B + root) / Auu };
+
+				for (double du : crossings) {
+					int position = static_cast<int>(std::lround((ellipsoid.centre[u] + du) / spacing[u]));
+					if (position >= 0 && position < size[u]) {
+						index[u] = position;
+						volume.set(index[0], index[1], index[2]);
+					}
+				}
+			}
+
+			B += stepB;
+			C += stepC;
+			stepC += stepStepC;
+		}
+	}
+}
+
+// This is the 3D version of Part_1::drawEllipses.
+// The nearest and farthest marked voxels are found (each thread scans a range of slices), and the ellipsoid is scaled to
+// pass through each of them.  For a voxel at d = p - centre the scale is sqrt(d' A d), which keeps the ellipsoid's shape
+bool EllipsoidShell::shells(const Ellipsoid& ellipsoid, const VoxelVolume& volume, EllipsoidShells& result) const {
+	struct Extremes {
+		double minDistance{ std::numeric_limits<double>::max() };
+		double maxDistance{ -1.0 };
+		int nearest[3]{};
+		int farthest[3]{};
+		size_t count{ 0 };
+	};
+
+	// Each thread records its own extremes
+	std::vector<Extremes> extremes(threads);
+
+	parallelFor(threads, volume.depth(), [&](unsigned int thread, int first, int last) {
+		Extremes local;
+
+		for (int z = first; z < last; ++z) {
+			double dz = z * spacing[2] - ellipsoid.centre[2];
+
+			for (int y = 0; y < volume.height(); ++y) {
+				double dy = y * spacing[1] - ellipsoid.centre[1];
+				const uint64_t* row = volume.row(y, z);
+
+				for (size_t word = 0; word < volume.wordsPerRow(); ++word) {
+					uint64_t bits = row[word];
+					while (bits) {
+						int x = static_cast<int>(word * 64 + lowestSetBit(bits));
+						bits &= bits - 1;
+
+						double dx = x * spacing[0] - ellipsoid.centre[0];
+						double distance = dx * dx + dy * dy + dz * dz;
+
+						if (distance < local.minDistance) {
+							local.minDistance = distance;
+							local.nearest[0] = x;
+							local.nearest[1] = y;
+							local.nearest[2] = z;
+						}
+
+						if (distance > local.maxDistance) {
+							local.maxDistance = distance;
+							local.farthest[0] = x;
+							local.farthest[1] = y;
+							local.farthest[2] = z;
+						}
+
+						++local.count;
+					}
+				}
+			}
+		}
+
+		extremes[thread] = local;
+	});
+
+	Extremes total;
+	for (auto& local : extremes) {
+		if (local.count == 0) {
+			continue;
+		}
+
+		if (local.minDistance < total.minDistance) {
+			total.minDistance = local.minDistance;
+			std::copy(local.nearest, local.nearest + 3, total.nearest);
+		}
+
+		if (local.maxDistance > total.maxDistance) {
+			total.maxDistance = local.maxDistance;
+			std::copy(local.farthest, local.farthest + 3, total.farthest);
+		}
+
+		total.count += local.count;
+	}
+
+	if (total.count == 0) {
+		return false;
+	}
+
+	Matrix3 form = quadraticForm(ellipsoid);
+	auto scaleThrough = [&](const int voxel[3]) {
+		Vector3 d;
+		for (int i = 0; i < 3; ++i) {
+			d(i, 0) = voxel[i] * spacing[i] - ellipsoid.centre[i];
+		}
+
+		return sqrt((d.transpose() * form * d)(0, 0));
+	};
+
+	double scaleNear = scaleThrough(total.nearest);
+	double scaleFar  = scaleThrough(total.farthest);
+
+	result.nearest  = ellipsoid;
+	result.farthest = ellipsoid;
+	for (int i = 0; i < 3; ++i) {
+		result.nearest.axes[i]  *= scaleNear;
+		result.farthest.axes[i] *= scaleFar;
+
+		result.nearestVoxel[i]  = total.nearest[i];
+		result.farthestVoxel[i] = total.farthest[i];
+	}
+
+	result.markedVoxels = total.count;
+
+	return true;
+}
@@ -0,0 +1,52 @@
+#ifndef __ELLIPSOID_SHELL_H__
+#define __ELLIPSOID_SHELL_H__
+// Volumetric version of Part 1: marks the voxels nearest to the surface of an ellipsoid, and finds the nearest and
+// farthest shells (the ellipsoid scaled to pass through the nearest and farthest marked voxels).
+//
+// The centre of voxel (i, j, k) is at (i * spacingX, j * spacingY, k * spacingZ)
+
+#include <cstddef>
+
+#include "Matrix.h"
+#include "VoxelVolume.h"
+
+struct Ellipsoid {
+	double centre[3];
+
+	// Semi-axes
+	double axes[3];
+
+	// Rows are the directions of the axes; the identity for an axis-aligned ellipsoid
+	Matrix3 rotation;
+};
+
+struct EllipsoidShells {
+	Ellipsoid nearest;
+	Ellipsoid farthest;
+
+	int nearestVoxel[3];
+	int farthestVoxel[3];
+
+	size_t markedVoxels;
+};
+
+class EllipsoidShell {
+public:
+	// A thread count of 0 uses all available cores
+	EllipsoidShell(double spacingX = 1.0, double spacingY = 1.0, double spacingZ = 1.0, unsigned int threads = 0);
+
+	// Marks the voxels nearest to the surface (the volume is not cleared first)
+	void mark(const Ellipsoid& ellipsoid, VoxelVolume& volume) const;
+
+	// Returns false if no voxels are marked
+	bool shells(const Ellipsoid& ellipsoid, const VoxelVolume& volume, EllipsoidShells& result) const;
+
+private:
+	void sweep(const Ellipsoid& ellipsoid, const Matrix3& form, int u, int v, int w, int firstSlice, int lastSlice,
+		VoxelVolume& volume) const;
+
+	double spacing[3];
+	unsigned int threads;
+};
+
+#endif
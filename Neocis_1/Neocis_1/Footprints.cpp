@@ -0,0 +1,165 @@
+#include "Footprints.h"
+
+#include <algorithm>
+
+#include "Parallel.h"
+
+void Footprints::reset(size_t cells) {
+	_cells = cells;
+	clear();
+}
+
+void Footprints::clear() {
+	indices.clear();
+	offsets.assign(1, 0);
+}
+
+void Footprints::add(const CellBitset& footprint) {
+	footprint.forEach([this](size_t index) { indices.push_back(static_cast<uint32_t>(index)); });
+	offsets.push_back(indices.size());
+}
+
+void Footprints::dropOldest(size_t count) {
+	count = std::min(count, size());
+
+	uint64_t dropped = offsets[count];
+	indices.erase(indices.begin(), indices.begin() + dropped);
+	offsets.erase(offsets.begin(), offsets.begin() + count);
+
+	for (auto& offset : offsets) {
+		offset -= dropped;
+	}
+}
+
+CellBitset Footprints::footprint(size_t index) const {
+	CellBitset result(_cells);
+	for (uint64_t i = offsets[index]; i < offsets[index + 1]; ++i) {
+		result.set(indices[i]);
+	}
+
+	return result;
+}
+
+bool Footprints::assign(const uint32_t* cellIndices, size_t cellIndexCount, const uint64_t* offsetTable, size_t count) {
+	clear();
+
+	// Offsets must start at 0, never decrease, and end at the number of indices.  They are all checked before any index is
+	// read, so a bad table can't read past the indices
+	if (offsetTable[0] != 0 || offsetTable[count] != cellIndexCount) {
+		return false;
+	}
+
+	for (size_t footprint = 0; footprint < count; ++footprint) {
+		if (offsetTable[footprint + 1] < offsetTable[footprint] || offsetTable[footprint + 1] > cellIndexCount) {
+			return false;
+		}
+	}
+
+	// Each footprint's indices must be increasing and in the grid
+	for (size_t footprint = 0; footprint < count; ++footprint) {
+		for (uint64_t i = offsetTable[footprint]; i < offsetTable[footprint + 1]; ++i) {
+			if (cellIndices[i] >= _cells || (i > offsetTable[footprint] && cellIndices[i] <= cellIndices[i - 1])) {
+				return false;
+			}
+		}
+	}
+
+	indices.assign(cellIndices, cellIndices + cellIndexCount);
+	offsets.assign(offsetTable, offsetTable + count + 1);
+
+	return true;
+}
+
+// The footprints are added one at a time into a bit-sliced counter: plane b holds bit b of the count for each of the 64 cells
+// of a word, so a whole word of cells is counted with a few word operations (a ripple-carry adder across the planes).
+// Each footprint is expanded into words as it is added, and only the words it touches are updated.
+// Counts too large for the planes set the overflow word.  The count is then compared with k, plane by plane from the top
+CellBitset Footprints::atLeast(int k) const {
+	CellBitset result(_cells);
+	if (k <= 0) {
+		for (size_t i = 0; i < _cells; ++i) {
+			result.set(i);
+		}
+
+		return result;
+	}
+
+	// Number of planes needed to hold k
+	int planes{ 0 };
+	while ((k >> planes) != 0) {
+		++planes;
+	}
+
+	size_t wordCount = (_cells + 63) / 64;
+	std::vector<uint64_t> counter(planes * wordCount);
+	std::vector<uint64_t> overflow(wordCount);
+
+	for (size_t footprint = 0; footprint < size(); ++footprint) {
+		uint64_t i = offsets[footprint];
+		uint64_t end = offsets[footprint + 1];
+
+		while (i < end) {
+			// The indices are sorted, so the cells in one word are consecutive
+			size_t word = indices[i] >> 6;
+			uint64_t carry{ 0 };
+			for (; i < end && (indices[i] >> 6) == word; ++i) {
+				carry |= uint64_t{ 1 } << (indices[i] & 63);
+			}
+
+			for (int plane = 0; plane < planes && carry; ++plane) {
+				uint64_t& count = counter[plane * wordCount + word];
+
+				uint64_t next = count & carry;
+				count ^= carry;
+				carry = next;
+			}
+
+			overflow[word] |= carry;
+		}
+	}
+
+	// count >= k:  greater at the first plane that differs from k, or equal on all planes.
+	// Cells that are not marked at all (including the padding past the last cell) have a count of 0, so are never set
+	uint64_t* output = result.words();
+	for (size_t word = 0; word < wordCount; ++word) {
+		uint64_t greater{ 0 };
+		uint64_t equal{ ~uint64_t{ 0 } };
+		for (int plane = planes - 1; plane >= 0; --plane) {
+			uint64_t count = counter[plane * wordCount + word];
+
+			if ((k >> plane) & 1) {
+				equal &= count;
+			} else {
+				greater |= equal & count;
+				equal &= ~count;
+			}
+		}
+
+		output[word] = overflow[word] | greater | equal;
+	}
+
+	return result;
+}
+
+// Each thread expands footprint i into a bitset and tests the cells of footprints j >= i against it (the matrix is symmetric).
+// Row i needs size - i footprints, so each thread takes the next row when it is done to balance the work
+std::vector<size_t> Footprints::pairwiseOverlaps() const {
+	size_t n = size();
+	std::vector<size_t> overlaps(n * n);
+
+	parallelForEach(threadCount(0), 0, static_cast<int>(n), [&](int i) {
+		CellBitset row = footprint(i);
+
+		for (size_t j = i; j < n; ++j) {
+			size_t count{ 0 };
+			for (uint64_t cell = offsets[j]; cell < offsets[j + 1]; ++cell) {
+				count += row.test(indices[cell]);
+			}
+
+			overlaps[i * n + j] = count;
+			overlaps[j * n + i] = count;
+		}
+	});
+
+	return overlaps;
+}
@@ -0,0 +1,53 @@
+#ifndef __FOOTPRINTS_H__
+#define __FOOTPRINTS_H__
+// The cells marked by each ellipse drawn in Part 1 (its footprint), for set queries across ellipses.
+// An outline only marks O(a + b) cells, so footprints are stored sparsely, as sorted cell indices (all footprints one after
+// another, with a table of where each starts).  They are expanded into bitsets of 64 bit words when a query runs
+
+#include <cstdint>
+#include <vector>
+
+#include "CellBitset.h"
+
+class Footprints {
+public:
+	Footprints() { clear(); }
+
+	// Removes all footprints, and sets the number of cells in each
+	void reset(size_t cells);
+	void clear();
+
+	size_t cells() const { return _cells; }
+	size_t size() const { return offsets.size() - 1; }
+
+	void add(const CellBitset& footprint);
+	void dropOldest(size_t count);
+
+	CellBitset footprint(size_t index) const;
+
+	// Cells marked by at least k footprints
+	CellBitset atLeast(int k) const;
+
+	// Number of cells marked by both footprints i and j, for every pair (as a size x size matrix, row by row).
+	// Rows are split between threads
+	std::vector<size_t> pairwiseOverlaps() const;
+
+	// Memory used by the footprints
+	size_t bytes() const { return indices.capacity() * sizeof(uint32_t) + offsets.capacity() * sizeof(uint64_t); }
+
+	// Raw storage, for session files: the cell indices, and size() + 1 offsets (footprint i is indices [offsets[i], offsets[i + 1]))
+	const uint32_t* cellIndices() const { return indices.data(); }
+	size_t cellIndexCount() const { return indices.size(); }
+	const uint64_t* offsetTable() const { return offsets.data(); }
+
+	// Replaces all footprints.  Returns false (leaving no footprints) if the offsets or indices are not valid
+	bool assign(const uint32_t* cellIndices, size_t cellIndexCount, const uint64_t* offsetTable, size_t count);
+
+private:
+	size_t _cells{ 0 };
+
+	std::vector<uint32_t> indices;
+	std::vector<uint64_t> offsets;
+};
+
+#endif
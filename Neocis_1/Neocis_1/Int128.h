@@ -0,0 +1,86 @@
+#ifndef __INT128_H__
+#define __INT128_H__
+// A minimal signed 128 bit integer (two's complement), used for exact moment arithmetic.
+// Only the operations needed by the fits are provided.  Overflow wraps, as for unsigned integers.
+// A portable implementation is used because MSVC has no native 128 bit integer type
+
+#include <cstdint>
+
+class Int128 {
+public:
+	Int128() : lo{ 0 }, hi{ 0 } {}
+	Int128(int64_t value) : lo{ static_cast<uint64_t>(value) }, hi{ value < 0 ? ~uint64_t{ 0 } : 0 } {}
+
+	bool isNegative() const { return (hi >> 63) != 0; }
+
+	double toDouble() const {
+		if (isNegative()) {
+			return -(-*this).toDouble();
+		}
+
+		return static_cast<double>(hi) * 18446744073709551616.0 + static_cast<double>(lo);
+	}
+
+	Int128 operator-() const {
+		Int128 result;
+		result.lo = ~lo + 1;
+		result.hi = ~hi + (result.lo == 0 ? 1 : 0);
+
+		return result;
+	}
+
+	Int128& operator+=(const Int128& other) {
+		uint64_t sum = lo + other.lo;
+		hi += other.hi + (sum < lo ? 1 : 0);
+		lo = sum;
+
+		return *this;
+	}
+
+	Int128& operator-=(const Int128& other) {
+		return *this += -other;
+	}
+
+	Int128& operator*=(const Int128& other) {
+		uint64_t productHi;
+		uint64_t productLo = multiply(lo, other.lo, productHi);
+
+		hi = productHi + lo * other.hi + hi * other.lo;
+		lo = productLo;
+
+		return *this;
+	}
+
+	friend Int128 operator+(Int128 a, const Int128& b) { return a += b; }
+	friend Int128 operator-(Int128 a, const Int128& b) { return a -= b; }
+	friend Int128 operator*(Int128 a, const Int128& b) { return a *= b; }
+
+	friend bool operator==(const Int128& a, const Int128& b) { return a.lo == b.lo && a.hi == b.hi; }
+	friend bool operator!=(const Int128& a, const Int128& b) { return !(a == b); }
+
+private:
+	// Full 64 x 64 -> 128 bit unsigned product, computed from 32 bit halves
+	static uint64_t multiply(uint64_t a, uint64_t b, uint64_t& high) {
+		const uint64_t MASK{ 0xffffffff };
+
+		uint64_t aLo = a & MASK;
+		uint64_t aHi = a >> 32;
+		uint64_t bLo = b & MASK;
+		uint64_t bHi = b >> 32;
+
+		uint64_t p0 = aLo * bLo;
+		uint64_t p1 = aLo * bHi;
+		uint64_t p2 = aHi * bLo;
+		uint64_t p3 = aHi * bHi;
+
+		uint64_t middle = (p0 >> 32) + (p1 & MASK) + (p2 & MASK);
+
+		high = p3 + (p1 >> 32) + (p2 >> 32) + (middle >> 32);
+		return (p0 & MASK) | (middle << 32);
+	}
+
+	uint64_t lo;
+	uint64_t hi;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef __MATRIX_H__
+#define __MATRIX_H__
+// A small fixed-size matrix, used by the fits.
+// Sizes are compile-time constants and storage is a plain array, so matrices live on the stack and nothing is allocated
+
+#include <array>
+#include <cmath>
+
+template <int ROWS, int COLS>
+class Matrix {
+public:
+	Matrix() { values.fill(0.0); }
+
+	double& operator()(int row, int col) { return values[row * COLS + col]; }
+	double  operator()(int row, int col) const { return values[row * COLS + col]; }
+
+	static Matrix identity() {
+		Matrix result;
+		for (int i = 0; i < ROWS && i < COLS; ++i) {
+			result(i, i) = 1.0;
+		}
+
+		return result;
+	}
+
+	Matrix<COLS, ROWS> transpose() const {
+		Matrix<COLS, ROWS> result;
+		for (int row = 0; row < ROWS; ++row) {
+			for (int col = 0; col < COLS; ++col) {
+				result(col, row) = (*this)(row, col);
+			}
+		}
+
+		return result;
+	}
+
+	// Returns the sub-matrix of size R x C starting at (row, col)
+	template <int R, int C>
+	Matrix<R, C> block(int row, int col) const {
+		Matrix<R, C> result;
+		for (int i = 0; i < R; ++i) {
+			for (int j = 0; j < C; ++j) {
+				result(i, j) = (*this)(row + i, col + j);
+			}
+		}
+
+		return result;
+	}
+
+	Matrix operator+(const Matrix& other) const {
+		Matrix result;
+		for (int i = 0; i < ROWS * COLS; ++i) {
+			result.values[i] = values[i] + other.values[i];
+		}
+
+		return result;
+	}
+
+	template <int N>
+	Matrix<ROWS, N> operator*(const Matrix<COLS, N>& other) const {
+		Matrix<ROWS, N> result;
+		for (int row = 0; row < ROWS; ++row) {
+			for (int k = 0; k < COLS; ++k) {
+				double value = (*this)(row, k);
+				for (int col = 0; col < N; ++col) {
+					result(row, col) += value * other(k, col);
+				}
+			}
+		}
+
+		return result;
+	}
+
+	Matrix operator*(double scale) const {
+		Matrix result;
+		for (int i = 0; i < ROWS * COLS; ++i) {
+			result.values[i] = values[i] * scale;
+		}
+
+		return result;
+	}
+
+private:
+	std::array<double, ROWS * COLS> values;
+};
+
+typedef Matrix<3, 3> Matrix3;
+typedef Matrix<3, 1> Vector3;
+
+inline double determinant(const Matrix3& m) {
+	return
+		m(0, 0) * (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1)) -
+		m(0, 1) * (m(1, 0) * m(2, 2) - m(1, 2) * m(2, 0)) +
+		m(0, 2) * (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0));
+}
+
+// Inverse by the adjugate; returns false if the matrix is singular
+inline bool inverse(const Matrix3& m, Matrix3& result) {
+	double det = determinant(m);
+	if (det == 0.0 || !std::isfinite(det)) {
+		return false;
+	}
+
+	for (int row = 0; row < 3; ++row) {
+		for (int col = 0; col < 3; ++col) {
+			// Cofactor of (col, row), using cyclic indices to get the signs right
+			int r0 = (col + 1) % 3;
+			int r1 = (col + 2) % 3;
+			int c0 = (row + 1) % 3;
+			int c1 = (row + 2) % 3;
+
+			result(row, col) = (m(r0, c0) * m(r1, c1) - m(r0, c1) * m(r1, c0)) / det;
+		}
+	}
+
+	return true;
+}
+
+#endif
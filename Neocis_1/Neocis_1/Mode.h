@@ -0,0 +1,10 @@
+#ifndef __MODE_H__
+#define __MODE_H__
+// Shape drawn in Part 1, and fitted in Part 2
+
+enum Mode {
+	CIRCLE,
+	ELLIPSE
+};
+
+#endif
@@ -1,8 +1,13 @@
 #include "Neocis_1.h"
 
 #include <QDesktopServices>
+#include <QFileDialog>
+#include <QInputDialog>
+#include <QMessageBox>
 #include <QUrl>
 
+#include "SceneExport.h"
+
 Neocis_1::Neocis_1(QWidget* parent) : 
 	QMainWindow{ parent }
 {
@@ -22,6 +27,9 @@ Neocis_1::Neocis_1(QWidget* parent) :
 	part_1 = std::make_unique<Part_1>(0, 0, sceneWidth, sceneHeight);
 	part_2 = std::make_unique<Part_2>(0, 0, sceneWidth, sceneHeight);
 
+	part_1->setStatusListener([this](const QString& status) { ui.statusBar->showMessage(status); });
+	part_1->setHistoryCap(ui.spinBoxHistory->value());
+
 	// Select and show part1
 	ui.graphicsView->setScene(part_1.get());
 	ui.graphicsView->show();
@@ -31,41 +39,74 @@ void Neocis_1::on_pushButtonOnlineHelp_clicked() {
 	QDesktopServices::openUrl(QUrl("https://github.com/NissimHadar/Hazel/blob/master/Neocis_1/docs/Neocis_1.md"));
 }
 
+// The shape is used both for drawing (Part 1) and for fitting (Part 2)
 void Neocis_1::on_radioButtonCircle_clicked() {
 	part_1->setMode(CIRCLE);
+	part_2->setMode(CIRCLE);
 }
 
 void Neocis_1::on_radioButtonEllipse_clicked() {
 	part_1->setMode(ELLIPSE);
+	part_2->setMode(ELLIPSE);
 }
 
 void Neocis_1::on_pushButtonClear_clicked() {
 	part_1->clear();
 }
 
+// Queries combine the squares marked by different ellipses (see Part_1::query)
+void Neocis_1::on_pushButtonQuery_clicked() {
+	QString message;
+	int count = part_1->query(ui.lineEditQuery->text(), message);
+
+	if (count < 0) {
+		QMessageBox::information(this, "Query", message);
+	} else {
+		ui.statusBar->showMessage(QString::number(count) + " squares");
+	}
+}
+
+void Neocis_1::on_pushButtonOverlaps_clicked() {
+	QString table = part_1->overlapTable();
+	QMessageBox::information(this, "Squares shared by each pair of ellipses", table.isEmpty() ? "There are no ellipses" : table);
+}
+
+// Older ellipses are dropped when the history exceeds this number.
+// The box doesn't track the keyboard, so the cap is only applied once a number has been typed in full
+void Neocis_1::on_spinBoxHistory_valueChanged(int value) {
+	part_1->setHistoryCap(value);
+}
+
 // Part2
 // This checkbox is used to select the "Part 2 program"
 void Neocis_1::on_checkBoxPart2_clicked() {
 	if (ui.checkBoxPart2->isChecked()) {
-		ui.radioButtonCircle->setEnabled(false);
-		ui.radioButtonEllipse->setEnabled(false);
 		ui.pushButtonClear->setEnabled(false);
+		ui.pushButtonQuery->setEnabled(false);
+		ui.pushButtonOverlaps->setEnabled(false);
+		ui.spinBoxHistory->setEnabled(false);
 
 		ui.pushButtonGenerate->setEnabled(true);
+		ui.checkBoxStream->setEnabled(true);
 		ui.graphicsView->setScene(part_2.get());
 	} else {
-		ui.radioButtonCircle->setEnabled(true);
-		ui.radioButtonEllipse->setEnabled(true);
 		ui.pushButtonClear->setEnabled(true);
+		ui.pushButtonQuery->setEnabled(true);
+		ui.pushButtonOverlaps->setEnabled(true);
+		ui.spinBoxHistory->setEnabled(true);
 
 		ui.pushButtonGenerate->setEnabled(false);
+
+		// Streaming only runs while Part 2 is shown
+		part_2->stopStreaming();
+		ui.checkBoxStream->setChecked(false);
+		ui.checkBoxStream->setEnabled(false);
 		ui.graphicsView->setScene(part_1.get());
 	}
 }
 
 // The generate button is also used to clear the points and circle
 void Neocis_1::on_pushButtonGenerate_clicked() {
-	static bool readyToGenerate{ true };
 	if (readyToGenerate) {
 		ui.pushButtonGenerate->setText("Clear");
 		part_2->generate();
@@ -77,6 +118,111 @@ void Neocis_1::on_pushButtonGenerate_clicked() {
 	readyToGenerate = !readyToGenerate;
 }
 
+// Bootstrap confidence intervals are drawn with generated circles
+void Neocis_1::on_checkBoxConfidence_clicked() {
+	part_2->setConfidence(ui.checkBoxConfidence->isChecked());
+}
+
+// While streaming, a circle is fitted to points read from STREAM_SERVER_NAME
+void Neocis_1::on_checkBoxStream_clicked() {
+	if (!ui.checkBoxStream->isChecked()) {
+		part_2->stopStreaming();
+		return;
+	}
+
+	if (!part_2->startStreaming(STREAM_SERVER_NAME, STREAM_WINDOW_SIZE, STREAM_WINDOW_MILLISECONDS)) {
+		QMessageBox::information(this, "Not streaming", "Could not connect to " + STREAM_SERVER_NAME);
+		ui.checkBoxStream->setChecked(false);
+	}
+}
+
+// Sessions hold the state of both parts
+void Neocis_1::on_pushButtonSave_clicked() {
+	QString fileName = QFileDialog::getSaveFileName(this, "Save session", QString(), "Sessions (*.neocis)");
+	if (fileName.isEmpty()) {
+		return;
+	}
+
+	SessionWriter writer;
+	part_1->saveSession(writer);
+	part_2->saveSession(writer);
+
+	if (!writer.write(fileName)) {
+		QMessageBox::critical(this, "Session not saved", writer.errorString());
+	}
+}
+
+void Neocis_1::on_pushButtonLoad_clicked() {
+	QString fileName = QFileDialog::getOpenFileName(this, "Load session", QString(), "Sessions (*.neocis)");
+	if (fileName.isEmpty()) {
+		return;
+	}
+
+	SessionReader reader;
+	if (!reader.open(fileName)) {
+		QMessageBox::critical(this, "Session not loaded", reader.errorString());
+		return;
+	}
+
+	// Both grids are checked before either part is changed
+	QString error;
+	if (!reader.grid(SESSION_GRID_PART_1, error) || !reader.grid(SESSION_GRID_PART_2, error)) {
+		QMessageBox::critical(this, "Session not loaded", error);
+		return;
+	}
+
+	part_1->loadSession(reader);
+	part_2->loadSession(reader);
+
+	// Loading clears any generated circle
+	readyToGenerate = true;
+	ui.pushButtonGenerate->setText("Generate");
+}
+
+// Exports the scene being shown, scaled up, as a single PNG or as a set of PNG tiles
+void Neocis_1::on_pushButtonExport_clicked() {
+	bool ok;
+	double scale = QInputDialog::getDouble(this, "Export", "Scale:", EXPORT_DEFAULT_SCALE, 1.0, EXPORT_MAX_SCALE, 1, &ok);
+	if (!ok) {
+		return;
+	}
+
+	const QString SINGLE_IMAGE{ "Single image" };
+	QString layout = QInputDialog::getItem(this, "Export", "Layout:", { SINGLE_IMAGE, "Tiles" }, 0, false, &ok);
+	if (!ok) {
+		return;
+	}
+
+	QString target = layout == SINGLE_IMAGE ?
+		QFileDialog::getSaveFileName(this, "Export image", QString(), "Images (*.png)") :
+		QFileDialog::getExistingDirectory(this, "Export tiles");
+
+	if (target.isEmpty()) {
+		return;
+	}
+
+	// The scene is copied before rendering starts
+	SceneExport exporter(*ui.graphicsView->scene(), scale);
+
+	ExportStatistics statistics;
+	bool written = layout == SINGLE_IMAGE ? exporter.writeImage(target, statistics) : exporter.writeTiles(target, statistics);
+
+	if (!written) {
+		QMessageBox::critical(this, "Export failed", exporter.errorString());
+		return;
+	}
+
+	QMessageBox::information(this, "Exported",
+		QString("%1 x %2 pixels\n%3 tiles in %4 s (%5 tiles/s)\nPeak image memory %6 MB")
+			.arg(exporter.width())
+			.arg(exporter.height())
+			.arg(statistics.tiles)
+			.arg(statistics.seconds, 0, 'f', 2)
+			.arg(statistics.tilesPerSecond, 0, 'f', 1)
+			.arg(statistics.peakBytes / (1024.0 * 1024.0), 0, 'f', 1)
+	);
+}
+
 // Exit when closed
 void Neocis_1::on_pushButtonClose_clicked() {
 	exit(0);
@@ -22,6 +22,18 @@ private:
 	std::unique_ptr<Part_1> part_1;
 	std::unique_ptr<Part_2> part_2;
 
+	// True when the generate button will generate (rather than clear)
+	bool readyToGenerate{ true };
+
+	// Local socket (or named pipe) that tracked points are read from, and the window the circle is fitted to
+	const QString STREAM_SERVER_NAME{ "Neocis_1_tracker" };
+	const size_t STREAM_WINDOW_SIZE{ 1000 };
+	const int64_t STREAM_WINDOW_MILLISECONDS{ 1000 };
+
+	// Scale of exported images, relative to the scene
+	const double EXPORT_DEFAULT_SCALE{ 4.0 };
+	const double EXPORT_MAX_SCALE{ 100.0 };
+
 	// These can be changed, but remember to change the size of the canvas in Neocis_1.ui
 	const int SCENE_WIDTH { 840 };
 	const int SCENE_HEIGHT{ 840 };
@@ -34,8 +46,20 @@ private slots:
 
 	void on_pushButtonClear_clicked();
 
+	void on_pushButtonQuery_clicked();
+	void on_pushButtonOverlaps_clicked();
+	void on_spinBoxHistory_valueChanged(int value);
+
 	void on_checkBoxPart2_clicked();
 	void on_pushButtonGenerate_clicked();
+	void on_checkBoxConfidence_clicked();
+
+	void on_checkBoxStream_clicked();
+
+	void on_pushButtonSave_clicked();
+	void on_pushButtonLoad_clicked();
+
+	void on_pushButtonExport_clicked();
 
 	void on_pushButtonClose_clicked();
 };
@@ -0,0 +1,63 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+// Small helpers shared by the multi-threaded code: choosing a thread count, splitting work between threads, and the
+// bit trick used to walk the set bits of a word
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// The number of threads to use for a requested count, where 0 means all available cores
+inline unsigned int threadCount(unsigned int requested) {
+	return requested != 0 ? requested : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+// Splits [0, count) into one contiguous range per thread (using no more threads than there are items), and calls
+// function(thread, first, last) for each range on its own thread
+template <typename Function>
+void parallelFor(unsigned int threads, int count, Function function) {
+	unsigned int numberOfThreads = std::min(threads, static_cast<unsigned int>(std::max(count, 1)));
+
+	std::vector<std::thread> workers;
+	for (unsigned int thread = 0; thread < numberOfThreads; ++thread) {
+		int first = static_cast<int>(static_cast<int64_t>(count) * thread / numberOfThreads);
+		int last  = static_cast<int>(static_cast<int64_t>(count) * (thread + 1) / numberOfThreads);
+
+		workers.emplace_back(function, thread, first, last);
+	}
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+// Calls function(index) for every index in [first, last).  Each thread takes the next index when it is done, which
+// balances work whose cost varies from one index to the next
+template <typename Function>
+void parallelForEach(unsigned int threads, int first, int last, Function function) {
+	unsigned int numberOfThreads = std::min(threads, static_cast<unsigned int>(std::max(last - first, 1)));
+	std::atomic<int> next{ first };
+
+	std::vector<std::thread> workers;
+	for (unsigned int thread = 0; thread < numberOfThreads; ++thread) {
+		workers.emplace_back([&] {
+			for (int index = next++; index < last; index = next++) {
+				function(index);
+			}
+		});
+	}
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+// Index of the lowest set bit of a non-zero word: the number of trailing zeros is the count of the bits below the lowest set bit
+inline int lowestSetBit(uint64_t word) {
+	return static_cast<int>(std::bitset<64>((word & (~word + 1)) - 1).count());
+}
+
+#endif
@@ -2,6 +2,7 @@
 
 #include <QGraphicsRectItem>
 #include <QMessageBox>
+#include <QRegularExpression>
 #include <limits>
 
 Part_1::Part_1(int x, int y, int width, int height, QObject* parent) :
@@ -18,15 +19,13 @@ Part_1::Part_1(int x, int y, int width, int height, QObject* parent) :
 	mode{ CIRCLE },
 	verticalMarkerLine{ nullptr },
 	horizontalMarkerLine{ nullptr },
-	ellipse(nullptr)
+	ellipse(nullptr),
+	ellipseStore{ this }
 {
 	// Note that 1.0 is used to coerce double division
 	gridSpacingX = sceneWidth  / (numPointsWide + 1.0);
 	gridSpacingY = sceneHeight / (numPointsHigh + 1.0);
 
-	nearEllipses.clear();
-	farEllipses.clear();
-
 	drawGrid();
 }
 
@@ -34,6 +33,17 @@ void Part_1::setMode(Mode mode) {
 	this->mode = mode;
 }
 
+void Part_1::setHistoryCap(size_t maxEllipses) {
+	ellipseStore.setMaxRecords(maxEllipses);
+	trimFootprints();
+
+	reportStatus();
+}
+
+void Part_1::setStatusListener(std::function<void(const QString&)> listener) {
+	statusListener = listener;
+}
+
 void Part_1::mousePressEvent(QGraphicsSceneMouseEvent* event) {
 	centreX = event->scenePos().x();
 	centreY = event->scenePos().y();
@@ -84,14 +94,42 @@ void Part_1::clear() {
 		square->setBrush(QBrush(Qt::gray));
 	}
 
+	markedCells.clear();
+	extremeCells.clear();
+	footprints.clear();
+
+	clearHighlight();
+
 	// remove centre marker and all ellipses
 	removeCentreMarker();
 	removeEllipse(true);
+
+	reportStatus();
+}
+
+// Changes the number of grid points, and clears the scene
+void Part_1::setGridSize(int numPointsWide, int numPointsHigh) {
+	clear();
+
+	this->numPointsWide = numPointsWide;
+	this->numPointsHigh = numPointsHigh;
+
+	// Note that 1.0 is used to coerce double division
+	gridSpacingX = sceneWidth  / (numPointsWide + 1.0);
+	gridSpacingY = sceneHeight / (numPointsHigh + 1.0);
+
+	drawGrid();
 }
 
 // Draws a rectangle of squares, evenly divided over the scene
 void Part_1::drawGrid() {
 	squares.clear();
+	size_t cells = static_cast<size_t>(numPointsWide) * numPointsHigh;
+	markedCells.resize(cells);
+	extremeCells.resize(cells);
+	markedSquares.resize(cells);
+	footprints.reset(cells);
+
 	for (int row = 1; row <= numPointsWide; ++row) {
 		for (int col = 1; col <= numPointsHigh; ++col) {
 			int squareXCentre = row * gridSpacingX;
@@ -142,12 +180,7 @@ void Part_1::removeEllipse(bool all) {
 	}
 
 	if (all) {
-		for (auto& ellipse : farEllipses) {
-			removeItem(ellipse.get());
-		}
-		for (auto& ellipse : nearEllipses) {
-			removeItem(ellipse.get());
-		}
+		ellipseStore.clear();
 	}
 }
 
@@ -179,7 +212,7 @@ void Part_1::markSquares() {
 	const double a{ (ellipse->rect().right() - ellipse->rect().left()) / 2.0 };
 	const double b{ (ellipse->rect().bottom() - ellipse->rect().top()) / 2.0 };
 	
-	// Marked squares are stored in a set for later use
+	// Marked squares are stored in a bitset for later use
 	markedSquares.clear();
 
 	for (int col = std::max(1, leftMostColumn); col <= rightMostColumn; ++col) {
@@ -203,15 +236,11 @@ void Part_1::markSquares() {
 
 		// Don't draw outside of scene
 		if (rowTop >= 1 && rowTop < numPointsHigh) {
-			int indexTop = (col - 1) * numPointsWide + rowTop;
-			squares[indexTop]->setBrush(QBrush(Qt::blue));
-			markedSquares.insert(squares[indexTop]);
+			markSquare((col - 1) * numPointsHigh + rowTop);
 		}
 
 		if (rowBottom >= 1 && rowBottom < numPointsHigh) {
-			int indexBottom = (col - 1) * numPointsWide + rowBottom;
-			squares[indexBottom]->setBrush(QBrush(Qt::blue));
-			markedSquares.insert(squares[indexBottom]);
+			markSquare((col - 1) * numPointsHigh + rowBottom);
 		}
 	}
 
@@ -247,19 +276,21 @@ void Part_1::markSquares() {
 
 		// Don't draw outside of scene
 		if (colLeft >= 1 && colLeft <= numPointsWide) {
-			int indexLeft = (colLeft - 1) * numPointsWide + row - 1;
-			squares[indexLeft]->setBrush(QBrush(Qt::blue));
-			markedSquares.insert(squares[indexLeft]);
+			markSquare((colLeft - 1) * numPointsHigh + row - 1);
 		}
 
 		if (colRight >= 1 && colRight <= numPointsWide) {
-			int indexRight = (colRight - 1) * numPointsWide + row - 1;
-			squares[indexRight]->setBrush(QBrush(Qt::blue));
-			markedSquares.insert(squares[indexRight]);
+			markSquare((colRight - 1) * numPointsHigh + row - 1);
 		}
 	}
 }
 
+void Part_1::markSquare(int index) {
+	squares[index]->setBrush(QBrush(Qt::blue));
+	markedSquares.set(index);
+	markedCells.set(index);
+}
+
 // Both ellipses are drawn together as the calculations are similar
 // The algorithm loops over all marked squares and computes the distance from the centre to each square
 // It then draws ellipses to the nearest and farthest marked squares, keeping the ellipse's aspect ratio
@@ -267,10 +298,11 @@ void Part_1::drawEllipses() {
 	double maxDistance{ 0 };
 	double minDistance{ std::numeric_limits<double>::max() };
 
-	std::shared_ptr<QGraphicsRectItem> farthestSquare{ nullptr };
-	std::shared_ptr<QGraphicsRectItem> nearestSquare{ nullptr };
+	int farthestIndex{ -1 };
+	int nearestIndex{ -1 };
 
-	for (auto& square : markedSquares) {
+	markedSquares.forEach([&](size_t index) {
+		auto& square = squares[index];
 		double dx = centreX - square->rect().center().x();
 		double dy = centreY - square->rect().center().y();
 
@@ -278,25 +310,30 @@ void Part_1::drawEllipses() {
 
 		if (distanceToCentre > maxDistance) {
 			maxDistance = distanceToCentre;
-			farthestSquare = square;
+			farthestIndex = static_cast<int>(index);
 		}
 
 		if (distanceToCentre < minDistance) {
 			minDistance = distanceToCentre;
-			nearestSquare = square;
+			nearestIndex = static_cast<int>(index);
 		}
-	}
+	});
 
-	if (!farthestSquare || !nearestSquare) {
+	if (farthestIndex < 0 || nearestIndex < 0) {
 		QMessageBox::critical(0, "Internal error: " + QString(__FILE__) + ":" + QString::number(__LINE__),
 			"Couldn't find farthest or nearest square");
 		exit(-1);
 	}
 
-	// 
+	auto& farthestSquare = squares[farthestIndex];
+	auto& nearestSquare  = squares[nearestIndex];
+
 	farthestSquare->setBrush(QBrush(Qt::darkBlue));
 	nearestSquare->setBrush(QBrush(Qt::darkBlue));
 
+	extremeCells.set(farthestIndex);
+	extremeCells.set(nearestIndex);
+
 	// Polar coordinates are used to scale new ellipses
 	double farX  = farthestSquare->rect().center().x() - centreX;
 	double farY  = farthestSquare->rect().center().y() - centreY;
@@ -322,23 +359,219 @@ void Part_1::drawEllipses() {
 	double scaleFar  = sqrt(farX  * farX  + farY  * farY ) / actualEllipseRadiusFarSquare;
 	double scaleNear = sqrt(nearX * nearX + nearY * nearY) / actualEllipseRadiusNearSquare;
 
-	double farA  = actualA * scaleFar;
-	double farB  = actualB * scaleFar;
-	double nearA = actualA * scaleNear;
-	double nearB = actualB * scaleNear;
+	ellipseStore.add({ centreX, centreY, actualA, actualB, scaleNear, scaleFar });
 
-	std::unique_ptr<QGraphicsEllipseItem> farEllipse  = std::make_unique<QGraphicsEllipseItem>(centreX - farA,  centreY - farB,  2.0 * farA,  2.0 * farB );
-	std::unique_ptr<QGraphicsEllipseItem> nearEllipse = std::make_unique<QGraphicsEllipseItem>(centreX - nearA, centreY - nearB, 2.0 * nearA, 2.0 * nearB);
-	
-	QPen pen;
-	pen.setBrush(QBrush(Qt::red));
+	footprints.add(markedSquares);
+	trimFootprints();
 
-	farEllipse->setPen(pen);
-	nearEllipse->setPen(pen);
+	reportStatus();
+}
 
-	addItem(farEllipse.get());
-	addItem(nearEllipse.get());
+// Keeps the footprints aligned with the history, which drops its oldest records when it is compacted
+void Part_1::trimFootprints() {
+	if (footprints.size() > ellipseStore.history().size()) {
+		footprints.dropOldest(footprints.size() - ellipseStore.history().size());
+	}
+}
+
+void Part_1::reportStatus() const {
+	if (!statusListener) {
+		return;
+	}
+
+	EllipseStoreStatistics statistics = ellipseStore.statistics();
+
+	statusListener(QString("History: %1 of %2 ellipses, %3 shown, %4 pooled items, %5 compactions, about %6 KB (footprints %7 KB)")
+		.arg(statistics.records)
+		.arg(ellipseStore.maxRecords())
+		.arg(statistics.liveItems)
+		.arg(statistics.pooledItems)
+		.arg(statistics.compactions)
+		.arg((statistics.estimatedBytes + footprints.bytes()) / 1024.0, 0, 'f', 1)
+		.arg(footprints.bytes() / 1024.0, 0, 'f', 1)
+	);
+}
+
+// The grid, cell states and ellipse history are written straight from their storage
+void Part_1::saveSession(SessionWriter& writer) const {
+	writer.addValue(SESSION_GRID_PART_1, SessionGrid{ sceneWidth, sceneHeight, numPointsWide, numPointsHigh });
+	writer.addBitset(SESSION_MARKED_CELLS,  markedCells.words(),  markedCells.size());
+	writer.addBitset(SESSION_EXTREME_CELLS, extremeCells.words(), extremeCells.size());
+	writer.addArray(SESSION_ELLIPSE_HISTORY, ellipseStore.history().data(), ellipseStore.history().size());
+	writer.addArray(SESSION_FOOTPRINT_CELLS, footprints.cellIndices(), footprints.cellIndexCount());
+	writer.addArray(SESSION_FOOTPRINT_OFFSETS, footprints.offsetTable(), footprints.size() + 1);
+}
+
+bool Part_1::loadSession(const SessionReader& reader) {
+	QString error;
+	const SessionGrid* grid = reader.grid(SESSION_GRID_PART_1, error);
+	if (!grid) {
+		return false;
+	}
+
+	setGridSize(grid->numPointsWide, grid->numPointsHigh);
+
+	uint64_t numberOfBits;
+	const uint64_t* marked = reader.bitset(SESSION_MARKED_CELLS, numberOfBits);
+	if (marked && numberOfBits == markedCells.size()) {
+		markedCells.assign(marked, numberOfBits);
+		markedCells.forEach([this](size_t index) { squares[index]->setBrush(QBrush(Qt::blue)); });
+	}
+
+	const uint64_t* extreme = reader.bitset(SESSION_EXTREME_CELLS, numberOfBits);
+	if (extreme && numberOfBits == extremeCells.size()) {
+		extremeCells.assign(extreme, numberOfBits);
+		extremeCells.forEach([this](size_t index) { squares[index]->setBrush(QBrush(Qt::darkBlue)); });
+	}
+
+	uint64_t historyCount{ 0 };
+	const EllipseRecord* records = reader.array<EllipseRecord>(SESSION_ELLIPSE_HISTORY, historyCount);
+	if (records) {
+		ellipseStore.assign(records, historyCount);
+	}
+
+	// Footprints are only used if there is one for every ellipse in the file.  The history may have been compacted to the
+	// current cap as it was assigned, so the footprints are then trimmed to match
+	uint64_t cellIndexCount;
+	uint64_t numberOfOffsets;
+	const uint32_t* cellIndices = reader.array<uint32_t>(SESSION_FOOTPRINT_CELLS, cellIndexCount);
+	const uint64_t* offsets = reader.array<uint64_t>(SESSION_FOOTPRINT_OFFSETS, numberOfOffsets);
+	if (records && cellIndices && offsets && numberOfOffsets == historyCount + 1) {
+		footprints.assign(cellIndices, cellIndexCount, offsets, historyCount);
+		trimFootprints();
+	}
+
+	reportStatus();
+
+	return true;
+}
+
+// Queries combine the footprints of the ellipses in the history, numbered from 1 (the oldest):
+//
+//		i				cells marked by ellipse i
+//		i & j			cells marked by both
+//		i | j			cells marked by either
+//		i - j			cells marked by i but not by j
+//		>= k			cells marked by at least k ellipses
+//
+// Operators are applied left to right, so "1 | 2 - 3" is (1 | 2) - 3.  An empty query clears the highlight
+int Part_1::query(const QString& text, QString& message) {
+	QString trimmed = text.trimmed();
+	if (trimmed.isEmpty()) {
+		clearHighlight();
+		return 0;
+	}
+
+	if (footprints.size() == 0) {
+		message = "There are no ellipses to query";
+		return -1;
+	}
+
+	CellBitset result;
+
+	QRegularExpressionMatch atLeast = QRegularExpression("^>=\\s*(\\d+)$").match(trimmed);
+	if (atLeast.hasMatch()) {
+		result = footprints.atLeast(atLeast.captured(1).toInt());
+	} else {
+		// Alternating footprint numbers and operators
+		QRegularExpressionMatchIterator tokens = QRegularExpression("\\s*(\\d+|[&|-])").globalMatch(trimmed);
+
+		int position{ 0 };
+		QChar operation;
+		bool expectNumber{ true };
+		while (tokens.hasNext()) {
+			QRegularExpressionMatch token = tokens.next();
+			if (token.capturedStart() != position) {
+				break;
+			}
+
+			position = token.capturedEnd();
+			QString value = token.captured(1);
+
+			if (value[0].isDigit() != expectNumber) {
+				message = "Expected " + QString(expectNumber ? "an ellipse number" : "an operator") + " at \"" + value + "\"";
+				return -1;
+			}
+
+			if (!expectNumber) {
+				operation = value[0];
+			} else {
+				int number = value.toInt();
+				if (number < 1 || number > static_cast<int>(footprints.size())) {
+					message = "There is no ellipse " + value + " (ellipses are numbered 1 to " + QString::number(footprints.size()) + ")";
+					return -1;
+				}
+
+				CellBitset footprint = footprints.footprint(number - 1);
+				if (operation.isNull()) {
+					result = footprint;
+				} else if (operation == '&') {
+					result &= footprint;
+				} else if (operation == '|') {
+					result |= footprint;
+				} else {
+					result.andNot(footprint);
+				}
+			}
+
+			expectNumber = !expectNumber;
+		}
+
+		if (position != trimmed.length() || expectNumber) {
+			message = "Could not read the query \"" + trimmed + "\"";
+			return -1;
+		}
+	}
+
+	highlight(result);
+
+	return static_cast<int>(result.count());
+}
+
+// Only the newest MAX_ROWS ellipses are listed, to keep the table readable
+QString Part_1::overlapTable() const {
+	const size_t MAX_ROWS{ 16 };
+
+	size_t n = footprints.size();
+	std::vector<size_t> overlaps = footprints.pairwiseOverlaps();
+
+	size_t first = n > MAX_ROWS ? n - MAX_ROWS : 0;
+
+	QString table;
+	for (size_t i = first; i < n; ++i) {
+		table += QString::number(i + 1) + ":";
+		for (size_t j = first; j < n; ++j) {
+			table += "\t" + QString::number(overlaps[i * n + j]);
+		}
+
+		table += "\n";
+	}
+
+	return table;
+}
+
+// Highlighted squares are outlined by separate items on top of the grid, so the squares' own colours are unchanged
+void Part_1::highlight(const CellBitset& cells) {
+	clearHighlight();
+
+	QPen pen(Qt::yellow);
+	pen.setWidth(2);
+
+	cells.forEach([&](size_t index) {
+		QRectF rect = squares[index]->rect().adjusted(-2.0, -2.0, 2.0, 2.0);
+
+		std::unique_ptr<QGraphicsRectItem> item = std::make_unique<QGraphicsRectItem>(rect);
+		item->setPen(pen);
+		addItem(item.get());
+
+		highlightItems.emplace_back(move(item));
+	});
+}
+
+void Part_1::clearHighlight() {
+	for (auto& item : highlightItems) {
+		removeItem(item.get());
+	}
 
-	farEllipses.emplace_back(move(farEllipse));
-	nearEllipses.emplace_back(move(nearEllipse));
+	highlightItems.clear();
 }
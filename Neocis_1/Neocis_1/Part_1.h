@@ -4,31 +4,54 @@
 #include <QGraphicsScene>
 #include <QGraphicsSceneMouseEvent>
 
+#include "CellBitset.h"
+#include "EllipseStore.h"
+#include "Footprints.h"
+#include "Mode.h"
+#include "SessionFile.h"
+
+#include <functional>
 #include <vector>
-#include <set>
-enum Mode {
-	CIRCLE,
-	ELLIPSE
-};
+
 class Part_1 : public QGraphicsScene {
 public:
 	Part_1(int x, int y, int width, int height, QObject* parent = nullptr);
 
 	void setMode(Mode mode);
 
+	// Maximum number of ellipses kept in the history
+	void setHistoryCap(size_t maxEllipses);
+
+	// The listener is given a summary of the history (size, graphics items and memory) whenever it changes
+	void setStatusListener(std::function<void(const QString&)> listener);
+
 	void mousePressEvent(QGraphicsSceneMouseEvent* event);
 	void mouseMoveEvent(QGraphicsSceneMouseEvent* event);
 	void mouseReleaseEvent(QGraphicsSceneMouseEvent* event);
 
 	void clear();
+	void setGridSize(int numPointsWide, int numPointsHigh);
 	void drawGrid();
 	void drawCentreMarker(double x, double y);
 
 	void removeCentreMarker();
 	void removeEllipse(bool all = false);
 	void markSquares();
+	void markSquare(int index);
 	void drawEllipses();
 
+	void saveSession(SessionWriter& writer) const;
+	bool loadSession(const SessionReader& reader);
+
+	// Highlights the cells selected by a footprint query (see query), and returns the number of cells,
+	// or -1 (with message set) if the query is invalid
+	int query(const QString& text, QString& message);
+	void highlight(const CellBitset& cells);
+
+	// Table of the number of cells shared by each pair of ellipses
+	QString overlapTable() const;
+	void clearHighlight();
+
 private:
 	int sceneWidth;
 	int sceneHeight;
@@ -46,15 +69,30 @@ private:
 	Mode mode;
 
 	std::vector<std::shared_ptr<QGraphicsRectItem>> squares;
-	std::set<std::shared_ptr<QGraphicsRectItem>> markedSquares;
+	// Squares marked by the last ellipse
+	CellBitset markedSquares;
+
+	// The marked squares of each ellipse in the history (footprint i belongs to ellipse i)
+	Footprints footprints;
+
+	std::vector<std::unique_ptr<QGraphicsRectItem>> highlightItems;
+
+	void trimFootprints();
+	void reportStatus() const;
+
+	std::function<void(const QString&)> statusListener;
+
+	// State of all squares, by index
+	CellBitset markedCells;
+	CellBitset extremeCells;
 
 	std::unique_ptr<QGraphicsRectItem> verticalMarkerLine;
 	std::unique_ptr<QGraphicsRectItem> horizontalMarkerLine;
 	
 	std::unique_ptr<QGraphicsEllipseItem> ellipse;
 	
-	std::vector<std::unique_ptr<QGraphicsEllipseItem>> nearEllipses;
-	std::vector<std::unique_ptr<QGraphicsEllipseItem>> farEllipses;
+	// History of near and far ellipses
+	EllipseStore ellipseStore;
 
 	double gridSpacingX;
 	double gridSpacingY;
@@ -2,8 +2,12 @@
 
 #include <QGraphicsRectItem>
 #include <QFile>
+#include <QGuiApplication>
 #include <QMessageBox>
+#include <QScreen>
+#include <QtMath>
 
+#include <algorithm>
 #include <limits>
 
 Part_2::Part_2(int x, int y, int width, int height, QObject* parent) :
@@ -14,7 +18,16 @@ Part_2::Part_2(int x, int y, int width, int height, QObject* parent) :
 	numPointsWide{ 20 },
 	numPointsHigh{ 20 },
 	squareSize{ 12 },
-	circle{ nullptr }
+	selectedEllipseMoments{ width / 2.0, height / 2.0, 2.0 / std::max(width, height) },
+	mode{ CIRCLE },
+	confidenceEnabled{ false },
+	circle{ nullptr },
+	windowSize{ 0 },
+	windowMicroseconds{ 0 },
+	evictionsSinceRebuild{ 0 },
+	lastReceived{ 0 },
+	lastUpdateMicroseconds{ 0 },
+	maxLatencyMilliseconds{ 0.0 }
 {
 	// Note that 1.0 is used to coerce double division
 	gridSpacingX = sceneWidth / (numPointsWide + 1.0);
@@ -23,13 +36,37 @@ Part_2::Part_2(int x, int y, int width, int height, QObject* parent) :
 	drawGrid();
 }
 
+void Part_2::setMode(Mode mode) {
+	this->mode = mode;
+}
+
+void Part_2::setConfidence(bool enabled) {
+	confidenceEnabled = enabled;
+}
+
+// Changes the number of grid points, and clears the scene
+void Part_2::setGridSize(int numPointsWide, int numPointsHigh) {
+	clear();
+
+	this->numPointsWide = numPointsWide;
+	this->numPointsHigh = numPointsHigh;
+
+	// Note that 1.0 is used to coerce double division
+	gridSpacingX = sceneWidth / (numPointsWide + 1.0);
+	gridSpacingY = sceneHeight / (numPointsHigh + 1.0);
+
+	drawGrid();
+}
+
 // Draws a rectangle of squares, evenly divided over the scene
 void Part_2::drawGrid() {
 	squares.clear();
+	selectedCells.resize(static_cast<size_t>(numPointsWide) * numPointsHigh);
 	for (int row = 1; row <= numPointsWide; ++row) {
 		for (int col = 1; col <= numPointsHigh; ++col) {
-			int squareXCentre = row * gridSpacingX;
-			int squareYCentre = col * gridSpacingY;
+			// Square centres are exact multiples of the grid spacing, so that fits can work in grid indices
+			double squareXCentre = row * gridSpacingX;
+			double squareYCentre = col * gridSpacingY;
 
 			std::unique_ptr<QGraphicsRectItem> square = std::make_unique<QGraphicsRectItem>(
 				squareXCentre - squareSize / 2.0,
@@ -49,22 +86,33 @@ void Part_2::mousePressEvent(QGraphicsSceneMouseEvent* event) {
 	double x = event->scenePos().x();
 	double y = event->scenePos().y();
 
-	// If mouse is hovering over a square that isn't the active square then toggle this square's selection
-	// else, de-activate any active square
-	for (auto& square : squares) {
-		if (inSquare(x, y, square)) {
-			if (selectedSquares.find(square) == selectedSquares.end()) {
-				selectedSquares.insert(square);
-				square->setBrush(QBrush(Qt::green));
-			}
-			else {
-				selectedSquares.erase(square);
-				square->setBrush(QBrush(Qt::gray));
-			}
+	// If mouse is hovering over a square then toggle this square's selection
+	for (int i = 0; i < squares.size(); ++i) {
+		if (inSquare(x, y, squares[i])) {
+			toggleSquare(i);
 		}
 	}
 }
 
+// The fit moments are updated as squares are toggled
+void Part_2::toggleSquare(int index) {
+	auto& square = squares[index];
+	if (selectedSquares.find(square) == selectedSquares.end()) {
+		selectedSquares.insert(square);
+		selectedCells.set(index);
+		selectedMoments.add(squareColumn(index), squareRow(index));
+		selectedEllipseMoments.add(square->rect().center().x(), square->rect().center().y());
+		square->setBrush(QBrush(Qt::green));
+	}
+	else {
+		selectedSquares.erase(square);
+		selectedCells.reset(index);
+		selectedMoments.remove(squareColumn(index), squareRow(index));
+		selectedEllipseMoments.remove(square->rect().center().x(), square->rect().center().y());
+		square->setBrush(QBrush(Qt::gray));
+	}
+}
+
 // Returns true iff (x, y) is in the square
 bool Part_2::inSquare(double x, double y, std::shared_ptr<QGraphicsRectItem> square) {
 	double centreX = square->rect().center().x();
@@ -82,7 +130,32 @@ bool Part_2::inSquare(double x, double y, std::shared_ptr<QGraphicsRectItem> squ
 //
 //	The code is based on the following paper - http://www.spaceroots.org/documents/circle/circle-fitting.pdf
 //	(paper has been included with code
+//
+// In ellipse mode, a direct least squares ellipse fit is used instead
 void Part_2::generate() {
+	if (mode == ELLIPSE) {
+		// Need at least 5 points to define an ellipse
+		if (selectedSquares.size() < 5) {
+			QMessageBox::information(0, "No ellipse defined", "At least 5 points are needed");
+			return;
+		}
+
+		if (ellipseFit()) {
+			// The item is drawn around the origin, then rotated and moved to the ellipse centre
+			circle = std::make_unique<QGraphicsEllipseItem>(-fittedEllipse.a, -fittedEllipse.b, 2.0 * fittedEllipse.a, 2.0 * fittedEllipse.b);
+			circle->setRotation(qRadiansToDegrees(fittedEllipse.angle));
+			circle->setPos(fittedEllipse.centreX, fittedEllipse.centreY);
+
+			QPen pen;
+			pen.setBrush(QBrush(Qt::blue));
+			circle->setPen(pen);
+
+			addItem(circle.get());
+		}
+
+		return;
+	}
+
 	// Need at least 3 points to define a circle
 	if (selectedSquares.size() < 3) {
 		QMessageBox::information(0, "No circle defined", "At least 3 points are needed");
@@ -110,6 +183,10 @@ void Part_2::generate() {
 		circle->setPen(pen);
 
 		addItem(circle.get());
+
+		if (confidenceEnabled && points.size() > 3) {
+			drawConfidence();
+		}
 	}
 }
 
@@ -119,8 +196,18 @@ void Part_2::clear() {
 	}
 
 	selectedSquares.clear();
+	selectedCells.clear();
+	selectedMoments.clear();
+	selectedEllipseMoments.clear();
 
-	removeItem(circle.get());
+	if (circle) {
+		removeItem(circle.get());
+	}
+
+	for (auto& item : confidenceItems) {
+		removeItem(item.get());
+	}
+	confidenceItems.clear();
 }
 
 bool Part_2::computeAccurateFit() {
@@ -163,97 +250,217 @@ bool Part_2::computeAccurateFit() {
 	return true;
 }
 
-//		  Circle fit to a given set of data points (in 2D)
-//
-//		  This is an algebraic fit, disovered and rediscovered by many people.
-//		  One of the earliest publications is due to Kasa:
-//
-//		  I. Kasa, "A curve fitting procedure and its error analysis",
-//		  IEEE Trans. Inst. Meas., Vol. 25, pages 8-14, (1976)
-//
-//		 The method is based on the minimization of the function
+// Kasa's circle fit (see kasaSolve in CircleMoments.h)
 //
-//					 F = sum [(x-a)^2 + (y-b)^2 - R^2]^2
-//
-//		 This is perhaps the simplest and fastest circle fit.
-//
-//		 It works well when data points are sampled along an entire circle
-//		 or a large part of it (at least half circle).
-//
-//		 It does not work well when data points are sampled along a small arc
-//		 of a circle. In that case the method is heavily biased, it returns
-//		 circles that are too often too small.
-//
-//		 It is the oldest algebraic circle fit (first published in 1972?).
-//		 For 20-30 years it has been the most popular circle fit, at least
-//		 until the more robust Pratt fit (1987) and Taubin fit (1991) were invented.
-//
-//		   Nikolai Chernov  (September 2012)
+// Every selected square is at an integer multiple of the grid spacing, so the moments are accumulated exactly over the grid
+// indices as squares are selected (and de-selected), and are only converted to scene units here
 bool Part_2::KasaCircleFit() {
-	// Compute x- and y- sample means
-	double accumulatorX{ 0.0 };
-	double accumulatorY{ 0.0 };
-	int counter{ 0 };
-	// We are assured there are at least 3 points
-	for (int i = 0; i < points.size(); ++i) {
-		accumulatorX += points[i].x();
-		accumulatorY += points[i].y();
-
-		++counter;
+	CentredMoments moments = selectedMoments.centred(gridSpacingX, gridSpacingY);
+
+	if (!kasaSolve(moments, circleCentre, circleRadius)) {
+		QMessageBox::information(0, "No circle defined", "Points cannot be on a straight line");
+		return false;
+	}
+
+	return true;
+}
+
+void Part_2::saveSession(SessionWriter& writer) const {
+	writer.addValue(SESSION_GRID_PART_2, SessionGrid{ sceneWidth, sceneHeight, numPointsWide, numPointsHigh });
+	writer.addBitset(SESSION_SELECTED_CELLS, selectedCells.words(), selectedCells.size());
+}
+
+bool Part_2::loadSession(const SessionReader& reader) {
+	QString error;
+	const SessionGrid* grid = reader.grid(SESSION_GRID_PART_2, error);
+	if (!grid) {
+		return false;
 	}
 
-	double meanX{ accumulatorX / counter };
-	double meanY{ accumulatorY / counter };
-
-	// Compute moments 
-	double mxx{ 0.0 };
-	double myy{ 0.0 };
-	double mxy{ 0.0 };
-	double mxz{ 0.0 };
-	double myz{ 0.0 };
-
-	for (int i = 0; i < points.size(); ++i) {
-		double xi = points[i].x() - meanX;   //  centered x-coordinates
-		double yi = points[i].y() - meanY;   //  centered y-coordinates
-		double zi = xi * xi + yi * yi;
-
-		mxx += xi * xi;
-		myy += yi * yi;
-		mxy += xi * yi;
-		mxz += xi * zi;
-		myz += yi * zi;
+	setGridSize(grid->numPointsWide, grid->numPointsHigh);
+
+	uint64_t numberOfBits;
+	const uint64_t* selected = reader.bitset(SESSION_SELECTED_CELLS, numberOfBits);
+	if (selected && numberOfBits == selectedCells.size()) {
+		CellBitset cells;
+		cells.assign(selected, numberOfBits);
+		cells.forEach([this](size_t index) { toggleSquare(index); });
 	}
 
-	mxx /= points.size();
-	myy /= points.size();
-	mxy /= points.size();
-	mxz /= points.size();
-	myz /= points.size();
+	return true;
+}
+
+// The centre region is drawn as an ellipse, and the radius interval as two dashed circles around the fitted centre
+void Part_2::drawConfidence() {
+	BootstrapResult result;
+	if (!bootstrap.run(points, result)) {
+		return;
+	}
 
-	// Solving system of equations by Cholesky factorization
-	double g11 = sqrt(mxx);
-	double g12 = mxy / g11;
+	QPen pen;
+	pen.setBrush(QBrush(Qt::magenta));
+
+	const FittedEllipse& region = result.centreEllipse;
+	auto centreRegion = std::make_unique<QGraphicsEllipseItem>(-region.a, -region.b, 2.0 * region.a, 2.0 * region.b);
+	centreRegion->setRotation(qRadiansToDegrees(region.angle));
+	centreRegion->setPos(region.centreX, region.centreY);
+	centreRegion->setPen(pen);
+
+	pen.setStyle(Qt::DashLine);
+
+	auto radiusLow = std::make_unique<QGraphicsEllipseItem>(
+		circleCentre.x() - result.radiusLow, circleCentre.y() - result.radiusLow, 2.0 * result.radiusLow, 2.0 * result.radiusLow);
+	auto radiusHigh = std::make_unique<QGraphicsEllipseItem>(
+		circleCentre.x() - result.radiusHigh, circleCentre.y() - result.radiusHigh, 2.0 * result.radiusHigh, 2.0 * result.radiusHigh);
+	radiusLow->setPen(pen);
+	radiusHigh->setPen(pen);
+
+	auto label = std::make_unique<QGraphicsSimpleTextItem>(
+		QString("Radius %1 - %2 (%3%), %4 replicates in %5 ms")
+			.arg(result.radiusLow, 0, 'f', 2)
+			.arg(result.radiusHigh, 0, 'f', 2)
+			.arg(100.0 * CircleBootstrap::DEFAULT_CONFIDENCE)
+			.arg(result.replicates)
+			.arg(result.milliseconds, 0, 'f', 1)
+	);
+	label->setPos(5.0, 5.0);
 
-	double g22 = sqrt(myy - g12 * g12);
+	confidenceItems.emplace_back(std::move(centreRegion));
+	confidenceItems.emplace_back(std::move(radiusLow));
+	confidenceItems.emplace_back(std::move(radiusHigh));
+	confidenceItems.emplace_back(std::move(label));
 
-	const double EPSILON{ 0.00001 };
-	if (g22 < EPSILON) {
-		QMessageBox::information(0, "No circle defined", "Points cannot be on a straight line");
+	for (auto& item : confidenceItems) {
+		addItem(item.get());
+	}
+}
+
+// See EllipseMoments::solve
+bool Part_2::ellipseFit() {
+	if (!selectedEllipseMoments.solve(fittedEllipse)) {
+		QMessageBox::information(0, "No ellipse defined", "Points do not define an ellipse");
+		return false;
+	}
+
+	return true;
+}
+
+// The circle is redrawn at the display refresh rate, however fast points arrive
+bool Part_2::startStreaming(const QString& serverName, size_t windowSize, int64_t windowMilliseconds) {
+	stopStreaming();
+
+	stream = std::make_unique<PointStream>();
+	if (!stream->start(serverName)) {
+		stream.reset();
 		return false;
 	}
 
-	double d1 = mxz / g11;
-	double d2 = (myz - d1 * g12) / g22;
+	this->windowSize = std::max(windowSize, size_t{ 3 });
+	windowMicroseconds = windowMilliseconds * 1000;
+
+	window.clear();
+	windowMoments.clear();
+	evictionsSinceRebuild = 0;
+
+	lastReceived = 0;
+	lastUpdateMicroseconds = PointStream::nowMicroseconds();
+	maxLatencyMilliseconds = 0.0;
 
-	// Computing paramters of the fitting circle
+	// The streamed circle and its statistics are kept apart from a generated circle (blue) and its confidence label (top left)
+	streamCircle = std::make_unique<QGraphicsEllipseItem>();
+	QPen pen;
+	pen.setBrush(QBrush(Qt::darkCyan));
+	streamCircle->setPen(pen);
+	streamCircle->setVisible(false);
+	addItem(streamCircle.get());
 
-	double c = d2 / g22 / 2.0;
-	double b = (d1 - g12 * c) / g11 / 2.0;
+	streamLabel = std::make_unique<QGraphicsSimpleTextItem>();
+	streamLabel->setBrush(QBrush(Qt::darkCyan));
+	streamLabel->setPos(5.0, sceneHeight - 20.0);
+	addItem(streamLabel.get());
 
-	// Asssembling the output
-	circleCentre.setX(b + meanX);
-	circleCentre.setY(c + meanY);
-	circleRadius = sqrt(b * b + c * c + mxx + myy);
+	double refreshRate = QGuiApplication::primaryScreen() ? QGuiApplication::primaryScreen()->refreshRate() : 60.0;
+	streamTimer.setInterval(static_cast<int>(1000.0 / std::max(refreshRate, 1.0)));
+
+	QObject::connect(&streamTimer, &QTimer::timeout, [this]() { updateStream(); });
+	streamTimer.start();
 
 	return true;
 }
+
+void Part_2::stopStreaming() {
+	streamTimer.stop();
+	streamTimer.disconnect();
+
+	if (stream) {
+		stream->stop();
+		stream.reset();
+	}
+
+	window.clear();
+	windowMoments.clear();
+
+	streamCircle.reset();
+	streamLabel.reset();
+}
+
+// Drains the ring, slides the window and redraws.
+// Each point added or evicted updates the moments in O(1).  The moments are rebuilt from the window after every windowSize
+// evictions, so rounding errors from removing points can't build up (this is still O(1) per point on average)
+void Part_2::updateStream() {
+	int64_t now = PointStream::nowMicroseconds();
+
+	StreamRecord record;
+	while (stream->pop(record)) {
+		window.push_back(record);
+		windowMoments.add(record.x, record.y);
+
+		maxLatencyMilliseconds = std::max(maxLatencyMilliseconds, (now - record.timestampMicroseconds) / 1000.0);
+	}
+
+	while (!window.empty() &&
+		(window.size() > windowSize || (windowMicroseconds > 0 && now - window.front().timestampMicroseconds > windowMicroseconds)))
+	{
+		windowMoments.remove(window.front().x, window.front().y);
+		window.pop_front();
+
+		++evictionsSinceRebuild;
+	}
+
+	if (evictionsSinceRebuild >= windowSize) {
+		windowMoments.clear();
+		for (auto& point : window) {
+			windowMoments.add(point.x, point.y);
+		}
+
+		evictionsSinceRebuild = 0;
+	}
+
+	Point centre;
+	double radius;
+	bool found = windowMoments.count() >= 3 && kasaSolve(windowMoments.centred(), centre, radius);
+
+	streamCircle->setVisible(found);
+	if (found) {
+		streamCircle->setRect(centre.x() - radius, centre.y() - radius, 2.0 * radius, 2.0 * radius);
+	}
+
+	// Statistics are shown about twice a second
+	double elapsedSeconds = (now - lastUpdateMicroseconds) / 1000000.0;
+	if (elapsedSeconds >= 0.5) {
+		uint64_t received = stream->received();
+
+		streamLabel->setText(
+			QString("%1 points/s, %2 dropped, %3 points in window, latency %4 ms%5")
+				.arg(static_cast<qulonglong>((received - lastReceived) / elapsedSeconds))
+				.arg(static_cast<qulonglong>(stream->dropped()))
+				.arg(static_cast<qulonglong>(window.size()))
+				.arg(maxLatencyMilliseconds, 0, 'f', 1)
+				.arg(stream->isRunning() ? "" : " (disconnected)")
+		);
+
+		lastReceived = received;
+		lastUpdateMicroseconds = now;
+		maxLatencyMilliseconds = 0.0;
+	}
+}
@@ -3,30 +3,63 @@
 
 #include <QGraphicsScene>
 #include <QGraphicsSceneMouseEvent>
+#include <QGraphicsSimpleTextItem>
+#include <QTimer>
 #include <QWidget>
 
+#include <deque>
 #include <unordered_set>
 #include <vector>
 
+#include "CellBitset.h"
+#include "CircleBootstrap.h"
+#include "CircleMoments.h"
+#include "EllipseMoments.h"
+#include "Mode.h"
 #include "Point.h"
+#include "PointStream.h"
+#include "SessionFile.h"
 
 class Part_2 : public QGraphicsScene, public QWidget {
 public:
 	Part_2(int x, int y, int width, int height, QObject* parent = nullptr);
 
+	void setMode(Mode mode);
+	void setConfidence(bool enabled);
+
+	void setGridSize(int numPointsWide, int numPointsHigh);
 	void drawGrid();
 
 	void mousePressEvent(QGraphicsSceneMouseEvent* event);
+	void toggleSquare(int index);
 
 	bool inSquare(double x, double y, std::shared_ptr<QGraphicsRectItem> square);
 	void generate();
 	void clear();
+
+	void saveSession(SessionWriter& writer) const;
+	bool loadSession(const SessionReader& reader);
 	
 	bool computeAccurateFit();
 
 	// Implementation of Kasa's algorithm to find best fitting circle to set of 2D points
 	bool KasaCircleFit();
 
+	// Direct least squares fit of an ellipse to the selected points
+	bool ellipseFit();
+
+	// Draws the bootstrap confidence region of the centre, and confidence interval of the radius, of the fitted circle
+	void drawConfidence();
+
+	// Fits a circle to the latest windowSize points, no older than windowMilliseconds, read from a local socket
+	bool startStreaming(const QString& serverName, size_t windowSize, int64_t windowMilliseconds);
+	void stopStreaming();
+	void updateStream();
+
+	// Returns the column and row (both starting at 1) of the square at the given index
+	int squareColumn(int index) const { return index / numPointsHigh + 1; }
+	int squareRow(int index)    const { return index % numPointsHigh + 1; }
+
 private:
 	int sceneWidth;
 	int sceneHeight;
@@ -42,12 +75,44 @@ private:
 	std::vector<std::shared_ptr<QGraphicsRectItem>> squares;
 
 	std::unordered_set<std::shared_ptr<QGraphicsRectItem>> selectedSquares;
+	CellBitset selectedCells;
 	std::vector<Point> points;
 
+	// Moments of the selected squares, in grid indices
+	CircleMoments<int> selectedMoments;
+	EllipseMoments selectedEllipseMoments;
+
+	Mode mode;
+
+	bool confidenceEnabled;
+	CircleBootstrap bootstrap;
+
 	Point circleCentre;
 	double circleRadius;
 
+	FittedEllipse fittedEllipse;
+
+	// The generated circle or ellipse
 	std::unique_ptr<QGraphicsEllipseItem> circle;
+
+	std::vector<std::unique_ptr<QGraphicsItem>> confidenceItems;
+
+	// Streaming
+	std::unique_ptr<PointStream> stream;
+	QTimer streamTimer;
+
+	std::deque<StreamRecord> window;
+	CircleMoments<double> windowMoments;
+	size_t windowSize;
+	int64_t windowMicroseconds;
+	size_t evictionsSinceRebuild;
+
+	uint64_t lastReceived;
+	int64_t lastUpdateMicroseconds;
+	double maxLatencyMilliseconds;
+
+	std::unique_ptr<QGraphicsEllipseItem> streamCircle;
+	std::unique_ptr<QGraphicsSimpleTextItem> streamLabel;
 };
 
 #endif
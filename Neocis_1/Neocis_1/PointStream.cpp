@@ -0,0 +1,106 @@
+#include "PointStream.h"
+
+#include <QLocalSocket>
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+PointStream::PointStream(size_t capacity) :
+	ring{ capacity },
+	running{ false },
+	receivedCount{ 0 },
+	droppedCount{ 0 }
+{
+}
+
+PointStream::~PointStream() {
+	stop();
+}
+
+int64_t PointStream::nowMicroseconds() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// The socket is created (and connected) on the reader thread, which waits here until the connection succeeds or fails
+bool PointStream::start(const QString& serverName) {
+	stop();
+
+	std::promise<bool> connected;
+	std::future<bool> result = connected.get_future();
+
+	running = true;
+	reader = std::thread(&PointStream::run, this, serverName, std::move(connected));
+
+	if (!result.get()) {
+		stop();
+		return false;
+	}
+
+	return true;
+}
+
+void PointStream::stop() {
+	running = false;
+
+	if (reader.joinable()) {
+		reader.join();
+	}
+}
+
+// Blocking socket calls are used, so the thread needs no event loop.  The timeout on waiting for data bounds how long
+// stop() has to wait for the thread to notice
+void PointStream::run(QString serverName, std::promise<bool> connected) {
+	const int CONNECT_TIMEOUT_MS{ 1000 };
+	const int READ_TIMEOUT_MS{ 50 };
+
+	QLocalSocket socket;
+	socket.connectToServer(serverName, QIODevice::ReadOnly);
+
+	if (!socket.waitForConnected(CONNECT_TIMEOUT_MS)) {
+		running = false;
+		connected.set_value(false);
+		return;
+	}
+
+	connected.set_value(true);
+
+	// Records are read in blocks; a partial record at the end of a block is kept for the next read
+	const size_t BLOCK_RECORDS{ 4096 };
+	std::vector<char> block(BLOCK_RECORDS * sizeof(StreamRecord));
+	size_t pending{ 0 };
+
+	while (running) {
+		if (socket.bytesAvailable() == 0 && !socket.waitForReadyRead(READ_TIMEOUT_MS)) {
+			if (socket.state() != QLocalSocket::ConnectedState) {
+				break;
+			}
+
+			continue;
+		}
+
+		qint64 bytes = socket.read(block.data() + pending, block.size() - pending);
+		if (bytes < 0) {
+			break;
+		}
+
+		pending += bytes;
+
+		size_t complete = pending / sizeof(StreamRecord);
+		for (size_t i = 0; i < complete; ++i) {
+			StreamRecord record;
+			std::memcpy(&record, block.data() + i * sizeof(StreamRecord), sizeof(StreamRecord));
+
+			if (!ring.push(record)) {
+				++droppedCount;
+			}
+		}
+
+		receivedCount += complete;
+
+		pending -= complete * sizeof(StreamRecord);
+		std::memmove(block.data(), block.data() + complete * sizeof(StreamRecord), pending);
+	}
+
+	running = false;
+}
@@ -0,0 +1,58 @@
+#ifndef __POINT_STREAM_H__
+#define __POINT_STREAM_H__
+// Reads points from a local socket (a UNIX domain socket, or a named pipe on Windows) on its own thread, and passes them
+// to the GUI thread through a lock-free ring buffer.
+//
+// The sender writes a stream of little-endian StreamRecords.  The timestamp is the time the point was sent, in microseconds
+// since the epoch (as std::chrono::system_clock), and is used to measure end-to-end latency
+
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <thread>
+
+#include "SpscRing.h"
+
+struct StreamRecord {
+	double x;
+	double y;
+	int64_t timestampMicroseconds;
+};
+
+class PointStream {
+public:
+	PointStream(size_t capacity = DEFAULT_CAPACITY);
+	~PointStream();
+
+	// Connects to the server and starts reading.  Returns false if the connection failed
+	bool start(const QString& serverName);
+	void stop();
+
+	bool isRunning() const { return running; }
+
+	// Called from the GUI thread
+	bool pop(StreamRecord& record) { return ring.pop(record); }
+
+	// Points read from the socket, and points dropped because the ring was full
+	uint64_t received() const { return receivedCount; }
+	uint64_t dropped() const { return droppedCount; }
+
+	static int64_t nowMicroseconds();
+
+	static const size_t DEFAULT_CAPACITY{ 1 << 16 };
+
+private:
+	void run(QString serverName, std::promise<bool> connected);
+
+	SpscRing<StreamRecord> ring;
+	std::thread reader;
+
+	std::atomic<bool> running;
+
+	std::atomic<uint64_t> receivedCount;
+	std::atomic<uint64_t> droppedCount;
+};
+
+#endif
@@ -0,0 +1,427 @@
+#include "SceneExport.h"
+
+#include <QDir>
+#include <QFile>
+#include <QGraphicsEllipseItem>
+#include <QGraphicsLineItem>
+#include <QGraphicsRectItem>
+#include <QGraphicsSimpleTextItem>
+#include <QPainter>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+// Qt's own copy of zlib on Windows; the system zlib elsewhere
+#ifdef Q_OS_WIN
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+#include "Parallel.h"
+
+// Current and peak image memory, updated from the worker threads
+class MemoryMeter {
+public:
+	void add(size_t bytes) {
+		size_t total = current += bytes;
+
+		size_t previous = peak.load();
+		while (total > previous && !peak.compare_exchange_weak(previous, total)) {
+		}
+	}
+
+	void release(size_t bytes) { current -= bytes; }
+
+	size_t peakBytes() const { return peak; }
+
+private:
+	std::atomic<size_t> current{ 0 };
+	std::atomic<size_t> peak{ 0 };
+};
+
+// Writes a PNG one row at a time.
+// PNG image data is a zlib stream, which is compressed as it goes (deflate with Z_NO_FLUSH for each row, and Z_FINISH at
+// the end), so memory is bounded whatever the size of the image.  Rows use the "Up" filter (the difference from the row
+// above), which turns the many rows that repeat the one above into zeros.  Compressed data is written as IDAT chunks of
+// up to BUFFER_SIZE bytes
+class PngWriter {
+public:
+	~PngWriter() {
+		if (streaming) {
+			deflateEnd(&stream);
+		}
+	}
+
+	bool open(const QString& fileName, int width, int height) {
+		file.setFileName(fileName);
+		if (!file.open(QIODevice::WriteOnly)) {
+			error = file.errorString();
+			return false;
+		}
+
+		static const uint8_t SIGNATURE[8]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+		file.write(reinterpret_cast<const char*>(SIGNATURE), sizeof(SIGNATURE));
+
+		// 8 bit RGB, no interlacing
+		uint8_t header[13];
+		putBigEndian(header, width);
+		putBigEndian(header + 4, height);
+		header[8] = 8;
+		header[9] = 2;
+		header[10] = header[11] = header[12] = 0;
+		chunk("IHDR", header, sizeof(header));
+
+		stream = z_stream();
+		if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+			error = "Could not start compression";
+			return false;
+		}
+
+		streaming = true;
+
+		previous.assign(3 * static_cast<size_t>(width), 0);
+		filtered.resize(1 + previous.size());
+		output.resize(BUFFER_SIZE);
+
+		return checkFile();
+	}
+
+	// A row of RGB pixels
+	bool writeRow(const uint8_t* pixels) {
+		filtered[0] = 2;
+		for (size_t i = 0; i < previous.size(); ++i) {
+			filtered[1 + i] = static_cast<uint8_t>(pixels[i] - previous[i]);
+		}
+
+		std::copy(pixels, pixels + previous.size(), previous.begin());
+
+		return compress(filtered.data(), filtered.size(), Z_NO_FLUSH);
+	}
+
+	bool close() {
+		bool ok = compress(nullptr, 0, Z_FINISH);
+
+		deflateEnd(&stream);
+		streaming = false;
+
+		if (ok) {
+			chunk("IEND", nullptr, 0);
+			ok = checkFile();
+		}
+
+		file.close();
+
+		return ok;
+	}
+
+	QString errorString() const { return error; }
+
+	// Memory used by the writer: the compressor's state (about 256 KB with the default settings, see zconf.h) and the
+	// row and output buffers
+	size_t bytes() const { return 256 * 1024 + previous.size() + filtered.size() + output.size(); }
+
+	static const size_t BUFFER_SIZE{ 1 << 20 };
+
+private:
+	// Compresses the data.  Whatever the compressor has ready is written as an IDAT chunk; the loop runs until the compressor
+	// stops filling the output buffer (for Z_FINISH this is the end of the stream)
+	bool compress(const uint8_t* data, size_t size, int flush) {
+		stream.next_in = const_cast<Bytef*>(data);
+		stream.avail_in = static_cast<uInt>(size);
+
+		do {
+			stream.next_out = output.data();
+			stream.avail_out = static_cast<uInt>(output.size());
+
+			if (deflate(&stream, flush) == Z_STREAM_ERROR) {
+				error = "Compression failed";
+				return false;
+			}
+
+			size_t compressed = output.size() - stream.avail_out;
+			if (compressed > 0) {
+				chunk("IDAT", output.data(), compressed);
+			}
+		} while (stream.avail_out == 0);
+
+		return checkFile();
+	}
+
+	bool checkFile() {
+		if (file.error() != QFile::NoError) {
+			error = file.errorString();
+			return false;
+		}
+
+		return true;
+	}
+
+	// Length, type, data, and CRC-32 of the type and data
+	void chunk(const char type[4], const uint8_t* data, size_t size) {
+		uint8_t length[4];
+		putBigEndian(length, static_cast<uint32_t>(size));
+		file.write(reinterpret_cast<const char*>(length), 4);
+
+		file.write(type, 4);
+		if (size > 0) {
+			file.write(reinterpret_cast<const char*>(data), size);
+		}
+
+		uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+		if (size > 0) {
+			crc = crc32(crc, data, static_cast<uInt>(size));
+		}
+
+		uint8_t check[4];
+		putBigEndian(check, static_cast<uint32_t>(crc));
+		file.write(reinterpret_cast<const char*>(check), 4);
+	}
+
+	static void putBigEndian(uint8_t* out, uint32_t value) {
+		out[0] = static_cast<uint8_t>(value >> 24);
+		out[1] = static_cast<uint8_t>(value >> 16);
+		out[2] = static_cast<uint8_t>(value >> 8);
+		out[3] = static_cast<uint8_t>(value);
+	}
+
+	QFile file;
+	QString error;
+
+	z_stream stream;
+	bool streaming{ false };
+
+	// Pixels of the row above, the filtered row, and compressed data not yet written
+	std::vector<uint8_t> previous;
+	std::vector<uint8_t> filtered;
+	std::vector<uint8_t> output;
+};
+
+SceneExport::SceneExport(const QGraphicsScene& scene, double scale, int tileSize, unsigned int threads) :
+	sceneRect{ scene.sceneRect() },
+	background{ scene.backgroundBrush() },
+	scale{ scale },
+	tileSize{ tileSize },
+	threads{ threadCount(threads) }
+{
+	imageWidth  = static_cast<int>(std::ceil(sceneRect.width()  * scale));
+	imageHeight = static_cast<int>(std::ceil(sceneRect.height() * scale));
+
+	tilesWide = (imageWidth  + tileSize - 1) / tileSize;
+	tilesHigh = (imageHeight + tileSize - 1) / tileSize;
+
+	bins.resize(static_cast<size_t>(tilesWide) * tilesHigh);
+
+	for (QGraphicsItem* item : scene.items(Qt::AscendingOrder)) {
+		if (!item->isVisible()) {
+			continue;
+		}
+
+		Primitive primitive;
+		if (auto rect = qgraphicsitem_cast<QGraphicsRectItem*>(item)) {
+			primitive.kind = Primitive::RECT;
+			primitive.rect = rect->rect();
+			primitive.pen = rect->pen();
+			primitive.brush = rect->brush();
+		} else if (auto ellipse = qgraphicsitem_cast<QGraphicsEllipseItem*>(item)) {
+			primitive.kind = Primitive::ELLIPSE;
+			primitive.rect = ellipse->rect();
+			primitive.pen = ellipse->pen();
+			primitive.brush = ellipse->brush();
+		} else if (auto line = qgraphicsitem_cast<QGraphicsLineItem*>(item)) {
+			primitive.kind = Primitive::LINE;
+			primitive.rect = QRectF(line->line().p1(), line->line().p2());
+			primitive.pen = line->pen();
+		} else if (auto text = qgraphicsitem_cast<QGraphicsSimpleTextItem*>(item)) {
+			primitive.kind = Primitive::TEXT;
+			primitive.rect = text->boundingRect();
+			primitive.text = text->text();
+			primitive.font = text->font();
+			primitive.pen = QPen(text->brush().color());
+		} else {
+			continue;
+		}
+
+		primitive.transform = item->sceneTransform();
+		primitive.opacity = item->effectiveOpacity();
+
+		// Tiles covered by the item, with a pixel to spare for antialiasing
+		QRectF bounds = item->sceneBoundingRect().translated(-sceneRect.topLeft());
+		int firstColumn = std::max(static_cast<int>(std::floor((bounds.left()   * scale - 1.0) / tileSize)), 0);
+		int lastColumn  = std::min(static_cast<int>(std::floor((bounds.right()  * scale + 1.0) / tileSize)), tilesWide - 1);
+		int firstRow    = std::max(static_cast<int>(std::floor((bounds.top()    * scale - 1.0) / tileSize)), 0);
+		int lastRow     = std::min(static_cast<int>(std::floor((bounds.bottom() * scale + 1.0) / tileSize)), tilesHigh - 1);
+
+		if (firstColumn > lastColumn || firstRow > lastRow) {
+			continue;
+		}
+
+		uint32_t index = static_cast<uint32_t>(primitives.size());
+		primitives.emplace_back(std::move(primitive));
+
+		for (int row = firstRow; row <= lastRow; ++row) {
+			for (int column = firstColumn; column <= lastColumn; ++column) {
+				bins[static_cast<size_t>(row) * tilesWide + column].push_back(index);
+			}
+		}
+	}
+}
+
+// Only the items in the tile's bin are drawn, in stacking order
+void SceneExport::renderTile(int row, int column, QImage& image) const {
+	int x = column * tileSize;
+	int y = row * tileSize;
+
+	image = QImage(std::min(tileSize, imageWidth - x), std::min(tileSize, imageHeight - y), QImage::Format_RGB32);
+	image.fill(Qt::white);
+
+	QPainter painter(&image);
+	painter.setRenderHint(QPainter::Antialiasing);
+	painter.setRenderHint(QPainter::TextAntialiasing);
+
+	if (background.style() != Qt::NoBrush) {
+		painter.fillRect(image.rect(), background);
+	}
+
+	// Scene coordinates to the tile's pixels
+	QTransform sceneToTile =
+		QTransform::fromTranslate(-sceneRect.left(), -sceneRect.top()) *
+		QTransform::fromScale(scale, scale) *
+		QTransform::fromTranslate(-x, -y);
+
+	for (uint32_t index : bins[static_cast<size_t>(row) * tilesWide + column]) {
+		const Primitive& primitive = primitives[index];
+
+		painter.setTransform(primitive.transform * sceneToTile);
+		painter.setOpacity(primitive.opacity);
+		painter.setPen(primitive.pen);
+		painter.setBrush(primitive.brush);
+
+		switch (primitive.kind) {
+		case Primitive::RECT:
+			painter.drawRect(primitive.rect);
+			break;
+
+		case Primitive::ELLIPSE:
+			painter.drawEllipse(primitive.rect);
+			break;
+
+		case Primitive::LINE:
+			painter.drawLine(primitive.rect.topLeft(), primitive.rect.bottomRight());
+			break;
+
+		case Primitive::TEXT:
+			painter.setFont(primitive.font);
+			painter.drawText(primitive.rect, Qt::AlignLeft | Qt::AlignTop, primitive.text);
+			break;
+		}
+	}
+}
+
+static void setStatistics(ExportStatistics& statistics, int tiles, std::chrono::steady_clock::time_point start, const MemoryMeter& memory) {
+	statistics.tiles = tiles;
+	statistics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	statistics.tilesPerSecond = statistics.seconds > 0.0 ? tiles / statistics.seconds : 0.0;
+	statistics.peakBytes = memory.peakBytes();
+}
+
+// Each thread renders a tile, writes it and takes the next, so at most one tile per thread is in memory
+bool SceneExport::writeTiles(const QString& directory, ExportStatistics& statistics) {
+	QDir dir(directory);
+	if (!dir.mkpath(".")) {
+		error = "Could not create " + directory;
+		return false;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	MemoryMeter memory;
+	std::atomic<bool> failed{ false };
+
+	int numberOfTiles = tilesWide * tilesHigh;
+	parallelForEach(threads, 0, numberOfTiles, [&](int tile) {
+		if (failed) {
+			return;
+		}
+
+		int row = tile / tilesWide;
+		int column = tile % tilesWide;
+
+		QImage image;
+		renderTile(row, column, image);
+		memory.add(image.sizeInBytes());
+
+		if (!image.save(dir.filePath(QString("tile_%1_%2.png").arg(row).arg(column)), "PNG")) {
+			failed = true;
+		}
+
+		memory.release(image.sizeInBytes());
+	});
+
+	if (failed) {
+		error = "Could not write tiles to " + directory;
+		return false;
+	}
+
+	setStatistics(statistics, numberOfTiles, start, memory);
+
+	return true;
+}
+
+// The tiles of a band are rendered in parallel, then the band is written row by row.  Only one band is in memory
+bool SceneExport::writeImage(const QString& fileName, ExportStatistics& statistics) {
+	auto start = std::chrono::steady_clock::now();
+
+	PngWriter png;
+	if (!png.open(fileName, imageWidth, imageHeight)) {
+		error = png.errorString();
+		return false;
+	}
+
+	MemoryMeter memory;
+
+	std::vector<uint8_t> line(3 * static_cast<size_t>(imageWidth));
+	memory.add(line.size() + png.bytes());
+
+	std::vector<QImage> band(tilesWide);
+	for (int row = 0; row < tilesHigh; ++row) {
+		parallelForEach(threads, 0, tilesWide, [&](int column) {
+			renderTile(row, column, band[column]);
+			memory.add(band[column].sizeInBytes());
+		});
+
+		for (int y = 0; y < band[0].height(); ++y) {
+			uint8_t* out = line.data();
+
+			for (const QImage& tile : band) {
+				const QRgb* pixels = reinterpret_cast<const QRgb*>(tile.constScanLine(y));
+				for (int x = 0; x < tile.width(); ++x) {
+					*out++ = static_cast<uint8_t>(qRed(pixels[x]));
+					*out++ = static_cast<uint8_t>(qGreen(pixels[x]));
+					*out++ = static_cast<uint8_t>(qBlue(pixels[x]));
+				}
+			}
+
+			if (!png.writeRow(line.data())) {
+				error = png.errorString();
+				return false;
+			}
+		}
+
+		for (QImage& tile : band) {
+			memory.release(tile.sizeInBytes());
+			tile = QImage();
+		}
+	}
+
+	if (!png.close()) {
+		error = png.errorString();
+		return false;
+	}
+
+	setStatistics(statistics, tilesWide * tilesHigh, start, memory);
+
+	return true;
+}
@@ -0,0 +1,85 @@
+#ifndef __SCENE_EXPORT_H__
+#define __SCENE_EXPORT_H__
+// Exports a scene at a larger scale than it is shown, e.g. at print resolution.
+//
+// The scene's items are copied into plain values on the GUI thread (graphics items must not be used from other threads).
+// The image is then split into tiles, which are rendered with QPainter into QImages on worker threads, so no GPU or
+// window system is needed (this also works with the offscreen platform).  Tiles are written to disk as they are rendered,
+// so the whole image is never held in memory.
+
+#include <QBrush>
+#include <QFont>
+#include <QGraphicsScene>
+#include <QImage>
+#include <QPen>
+#include <QRectF>
+#include <QString>
+#include <QTransform>
+
+#include <cstdint>
+#include <vector>
+
+struct ExportStatistics {
+	int tiles;
+	double seconds;
+	double tilesPerSecond;
+
+	// Largest amount of image memory (tiles and output buffers) used at one time
+	size_t peakBytes;
+};
+
+class SceneExport {
+public:
+	// Takes a snapshot of the scene.  Must be called on the GUI thread
+	SceneExport(const QGraphicsScene& scene, double scale, int tileSize = DEFAULT_TILE_SIZE, unsigned int threads = 0);
+
+	int width() const { return imageWidth; }
+	int height() const { return imageHeight; }
+
+	// Writes one PNG per tile, named tile_<row>_<column>.png, to the directory
+	bool writeTiles(const QString& directory, ExportStatistics& statistics);
+
+	// Writes a single PNG, one band (row of tiles) at a time.  The image data is compressed as it is written
+	bool writeImage(const QString& fileName, ExportStatistics& statistics);
+
+	const QString& errorString() const { return error; }
+
+	static const int DEFAULT_TILE_SIZE{ 1024 };
+
+private:
+	// A copy of one graphics item
+	struct Primitive {
+		enum Kind { RECT, ELLIPSE, LINE, TEXT } kind;
+
+		QRectF rect;		// rectangles and ellipses; the start and end of lines
+		QString text;
+		QFont font;
+
+		QPen pen;
+		QBrush brush;
+		QTransform transform;
+		double opacity;
+	};
+
+	void renderTile(int row, int column, QImage& image) const;
+
+	QRectF sceneRect;
+	QBrush background;
+	double scale;
+
+	int tileSize;
+	int imageWidth;
+	int imageHeight;
+	int tilesWide;
+	int tilesHigh;
+
+	unsigned int threads;
+
+	// Items in stacking order, and the items that overlap each tile (in the same order)
+	std::vector<Primitive> primitives;
+	std::vector<std::vector<uint32_t>> bins;
+
+	QString error;
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "SessionFile.h"
+
+#include <QtGlobal>
+
+#include <cstring>
+
+static const char SESSION_MAGIC[8]{ 'N', 'E', 'O', 'C', 'I', 'S', '_', 'S' };
+
+static_assert(sizeof(SessionHeader)  == 24, "Session header must be packed");
+static_assert(sizeof(SessionSection) == 32, "Session section table entry must be packed");
+static_assert(sizeof(SessionGrid)    == 16, "Session grid must be packed");
+
+// Sections start on 8 byte boundaries
+static uint64_t align(uint64_t offset) {
+	return (offset + 7) & ~uint64_t{ 7 };
+}
+
+void SessionWriter::addSection(uint32_t type, const void* data, uint64_t size, uint64_t count) {
+	SessionSection section;
+	section.type = type;
+	section.reserved = 0;
+	section.offset = 0;
+	section.size = size;
+	section.count = count;
+
+	sections.push_back(section);
+	sources.push_back(data);
+}
+
+// The layout is computed first, so the header, table and sections can then be written in order, straight from their sources
+bool SessionWriter::write(const QString& fileName) {
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+	error = "Session files are only supported on little-endian hosts";
+	return false;
+#endif
+
+	uint64_t offset = sizeof(SessionHeader) + sections.size() * sizeof(SessionSection);
+	for (auto& section : sections) {
+		section.offset = offset;
+		offset = align(offset + section.size);
+	}
+
+	SessionHeader header;
+	std::memcpy(header.magic, SESSION_MAGIC, sizeof(header.magic));
+	header.version = SessionReader::VERSION;
+	header.numberOfSections = static_cast<uint32_t>(sections.size());
+	header.fileSize = offset;
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		error = file.errorString();
+		return false;
+	}
+
+	bool ok = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header);
+	if (ok && !sections.empty()) {
+		qint64 tableSize = sections.size() * sizeof(SessionSection);
+		ok = file.write(reinterpret_cast<const char*>(sections.data()), tableSize) == tableSize;
+	}
+
+	const char padding[8]{};
+	for (size_t i = 0; ok && i < sections.size(); ++i) {
+		qint64 size = sections[i].size;
+		qint64 paddingSize = align(size) - size;
+
+		ok = (size == 0 || file.write(static_cast<const char*>(sources[i]), size) == size) &&
+			(paddingSize == 0 || file.write(padding, paddingSize) == paddingSize);
+	}
+
+	if (!ok) {
+		error = file.errorString();
+		return false;
+	}
+
+	return true;
+}
+
+bool SessionReader::open(const QString& fileName) {
+#if Q_BYTE_ORDER != Q_LITTLE_ENDIAN
+	error = "Session files are only supported on little-endian hosts";
+	return false;
+#endif
+
+	if (file.isOpen()) {
+		file.close();
+	}
+	mapping = nullptr;
+	sections = nullptr;
+	numberOfSections = 0;
+
+	file.setFileName(fileName);
+	if (!file.open(QIODevice::ReadOnly)) {
+		error = file.errorString();
+		return false;
+	}
+
+	qint64 size = file.size();
+	if (size < static_cast<qint64>(sizeof(SessionHeader))) {
+		error = "Not a session file";
+		return false;
+	}
+
+	// The mapping stays valid until the file is closed
+	mapping = file.map(0, size);
+	if (!mapping) {
+		error = file.errorString();
+		return false;
+	}
+
+	const SessionHeader* header = reinterpret_cast<const SessionHeader*>(mapping);
+	if (std::memcmp(header->magic, SESSION_MAGIC, sizeof(header->magic)) != 0) {
+		error = "Not a session file";
+		return false;
+	}
+
+	if (header->version != VERSION) {
+		error = QString("Unsupported session file version %1").arg(header->version);
+		return false;
+	}
+
+	uint64_t tableEnd = sizeof(SessionHeader) + static_cast<uint64_t>(header->numberOfSections) * sizeof(SessionSection);
+	if (header->fileSize != static_cast<uint64_t>(size) || tableEnd > header->fileSize) {
+		error = "Session file is truncated";
+		return false;
+	}
+
+	// Check every section is inside the file (written so that no sum can overflow), so accessors need no further checks
+	const SessionSection* table = reinterpret_cast<const SessionSection*>(mapping + sizeof(SessionHeader));
+	for (uint32_t i = 0; i < header->numberOfSections; ++i) {
+		const SessionSection& section = table[i];
+		if (section.offset < tableEnd || section.offset % 8 != 0 ||
+			section.offset > header->fileSize || section.size > header->fileSize - section.offset)
+		{
+			error = "Session file is corrupt";
+			return false;
+		}
+	}
+
+	sections = table;
+	numberOfSections = header->numberOfSections;
+
+	return true;
+}
+
+const SessionGrid* SessionReader::grid(uint32_t type, QString& error) const {
+	uint64_t count;
+	const SessionGrid* grid = array<SessionGrid>(type, count);
+	if (!grid || count != 1) {
+		error = "Session file is missing grid parameters";
+		return nullptr;
+	}
+
+	// The number of cells is computed in 64 bits, so it can't overflow
+	int64_t cells = static_cast<int64_t>(grid->numPointsWide) * grid->numPointsHigh;
+	if (grid->numPointsWide <= 0 || grid->numPointsHigh <= 0 ||
+		grid->numPointsWide > SESSION_MAX_GRID_POINTS || grid->numPointsHigh > SESSION_MAX_GRID_POINTS ||
+		cells > static_cast<int64_t>(SESSION_MAX_GRID_POINTS) * SESSION_MAX_GRID_POINTS)
+	{
+		error = QString("Session grid of %1 x %2 points is not supported (at most %3 x %3)")
+			.arg(grid->numPointsWide).arg(grid->numPointsHigh).arg(SESSION_MAX_GRID_POINTS);
+		return nullptr;
+	}
+
+	return grid;
+}
+
+const SessionSection* SessionReader::find(uint32_t type) const {
+	for (uint32_t i = 0; i < numberOfSections; ++i) {
+		if (sections[i].type == type) {
+			return &sections[i];
+		}
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,141 @@
+#ifndef __SESSION_FILE_H__
+#define __SESSION_FILE_H__
+// Binary session file.
+//
+// The format is little-endian and laid out so that a file can be memory-mapped and used in place:
+//
+//		Header			magic (8 bytes), version, number of sections, file size
+//		Section table	one entry per section: type, offset, size in bytes, number of elements
+//		Sections		raw arrays, each starting on an 8 byte boundary
+//
+// Bitset sections hold 64 bit words (the element count is the number of bits); other sections are arrays of the types below.
+// Writing streams each section straight from its source, and reading maps the file and returns pointers into the mapping
+
+#include <QFile>
+#include <QString>
+
+#include <cstdint>
+#include <vector>
+
+enum SessionSectionType : uint32_t {
+	SESSION_GRID_PART_1 = 1,		// SessionGrid
+	SESSION_GRID_PART_2,			// SessionGrid
+	SESSION_MARKED_CELLS,			// bitset of Part 1 marked cells
+	SESSION_EXTREME_CELLS,			// bitset of Part 1 nearest / farthest cells
+	SESSION_SELECTED_CELLS,			// bitset of Part 2 selected cells
+	SESSION_ELLIPSE_HISTORY,		// EllipseRecord
+	SESSION_FOOTPRINT_CELLS,		// uint32_t: sorted indices of the Part 1 cells marked by each ellipse in the history
+	SESSION_FOOTPRINT_OFFSETS		// uint64_t: where each ellipse's cells start, plus the total
+};
+
+// Largest grid that can be loaded, in points in each direction.  Every grid point is a graphics item, so much larger grids
+// would take a long time (and a lot of memory) to create
+const int32_t SESSION_MAX_GRID_POINTS{ 512 };
+
+struct SessionGrid {
+	int32_t sceneWidth;
+	int32_t sceneHeight;
+	int32_t numPointsWide;
+	int32_t numPointsHigh;
+};
+
+struct SessionHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t numberOfSections;
+	uint64_t fileSize;
+};
+
+struct SessionSection {
+	uint32_t type;
+	uint32_t reserved;
+	uint64_t offset;
+	uint64_t size;
+	uint64_t count;
+};
+
+class SessionWriter {
+public:
+	// The data must stay valid until write is called
+	void addSection(uint32_t type, const void* data, uint64_t size, uint64_t count);
+
+	template <typename T>
+	void addArray(uint32_t type, const T* data, uint64_t count) {
+		addSection(type, data, count * sizeof(T), count);
+	}
+
+	void addBitset(uint32_t type, const uint64_t* words, uint64_t numberOfBits) {
+		addSection(type, words, (numberOfBits + 63) / 64 * sizeof(uint64_t), numberOfBits);
+	}
+
+	// Small values are copied, so they don't need to outlive the writer
+	template <typename T>
+	void addValue(uint32_t type, const T& value) {
+		const char* bytes = reinterpret_cast<const char*>(&value);
+		values.emplace_back(bytes, bytes + sizeof(T));
+		addSection(type, values.back().data(), sizeof(T), 1);
+	}
+
+	bool write(const QString& fileName);
+
+	QString errorString() const { return error; }
+
+private:
+	std::vector<SessionSection> sections;
+	std::vector<const void*> sources;
+
+	// Moving the inner vectors keeps their data in place, so pointers to them stay valid
+	std::vector<std::vector<char>> values;
+
+	QString error;
+};
+
+class SessionReader {
+public:
+	// Maps the file and validates the header and section table
+	bool open(const QString& fileName);
+
+	// Returns a pointer to the section data (or nullptr if there is no such section), and its element count
+	template <typename T>
+	const T* array(uint32_t type, uint64_t& count) const {
+		const SessionSection* entry = find(type);
+		if (!entry || entry->count > entry->size / sizeof(T)) {
+			count = 0;
+			return nullptr;
+		}
+
+		count = entry->count;
+		return reinterpret_cast<const T*>(mapping + entry->offset);
+	}
+
+	const uint64_t* bitset(uint32_t type, uint64_t& numberOfBits) const {
+		const SessionSection* entry = find(type);
+		if (!entry || entry->count / 64 + ((entry->count % 64) ? 1 : 0) > entry->size / sizeof(uint64_t)) {
+			numberOfBits = 0;
+			return nullptr;
+		}
+
+		numberOfBits = entry->count;
+		return reinterpret_cast<const uint64_t*>(mapping + entry->offset);
+	}
+
+	// Returns the grid parameters, or nullptr (with error set) if they are missing or larger than SESSION_MAX_GRID_POINTS
+	const SessionGrid* grid(uint32_t type, QString& error) const;
+
+	QString errorString() const { return error; }
+
+	static const uint32_t VERSION{ 1 };
+
+private:
+	const SessionSection* find(uint32_t type) const;
+
+	QFile file;
+	const uchar* mapping{ nullptr };
+
+	const SessionSection* sections{ nullptr };
+	uint32_t numberOfSections{ 0 };
+
+	QString error;
+};
+
+#endif
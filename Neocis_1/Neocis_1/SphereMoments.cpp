@@ -0,0 +1,258 @@
+#include "SphereMoments.h"
+
+#include <cmath>
+
+#include "Matrix.h"
+
+// Index of the second order moment x_a * x_b
+static int second(int a, int b) {
+	static const int INDEX[3][3]{ { 4, 7, 8 }, { 7, 5, 9 }, { 8, 9, 6 } };
+	return INDEX[a][b];
+}
+
+// Index of the third order moment x_a * x_b^2
+static int third(int a, int b) {
+	return 10 + 3 * a + b;
+}
+
+// Computes the monomials summed for each point, in index order: 1, x, y, z, second and third order moments
+static inline void monomials(double x, double y, double z, double values[SphereMoments::SUMS]) {
+	double xx = x * x;
+	double yy = y * y;
+	double zz = z * z;
+
+	values[0] = 1.0;
+
+	values[1] = x;
+	values[2] = y;
+	values[3] = z;
+
+	values[4] = xx;
+	values[5] = yy;
+	values[6] = zz;
+	values[7] = x * y;
+	values[8] = x * z;
+	values[9] = y * z;
+
+	values[10] = x * xx;
+	values[11] = x * yy;
+	values[12] = x * zz;
+	values[13] = y * xx;
+	values[14] = y * yy;
+	values[15] = y * zz;
+	values[16] = z * xx;
+	values[17] = z * yy;
+	values[18] = z * zz;
+}
+
+void SphereMoments::clear() {
+	n = 0;
+	shift[0] = shift[1] = shift[2] = 0.0;
+
+	for (int i = 0; i < SUMS; ++i) {
+		sums[i] = 0.0;
+	}
+}
+
+void SphereMoments::add(double x, double y, double z) {
+	if (n == 0) {
+		shift[0] = x;
+		shift[1] = y;
+		shift[2] = z;
+	}
+
+	accumulate(x, y, z, 1.0);
+	++n;
+}
+
+void SphereMoments::remove(double x, double y, double z) {
+	accumulate(x, y, z, -1.0);
+	--n;
+
+	if (n == 0) {
+		clear();
+	}
+}
+
+void SphereMoments::accumulate(double x, double y, double z, double sign) {
+	double values[SUMS];
+	monomials(x - shift[0], y - shift[1], z - shift[2], values);
+
+	for (int i = 0; i < SUMS; ++i) {
+		sums[i] += sign * values[i];
+	}
+}
+
+// The points are processed in groups of 4, with each point of a group summed into its own lane.
+// The x, y and z arrays are read with unit stride and the lanes are independent, so the compiler can keep them in SIMD
+// registers; they are added together at the end
+void SphereMoments::add(const double* x, const double* y, const double* z, size_t count) {
+	if (count == 0) {
+		return;
+	}
+
+	if (n == 0) {
+		shift[0] = x[0];
+		shift[1] = y[0];
+		shift[2] = z[0];
+	}
+
+	const int LANES{ 4 };
+	double lanes[SUMS][LANES]{};
+
+	size_t i{ 0 };
+	for (; i + LANES <= count; i += LANES) {
+		double values[LANES][SUMS];
+		for (int lane = 0; lane < LANES; ++lane) {
+			monomials(x[i + lane] - shift[0], y[i + lane] - shift[1], z[i + lane] - shift[2], values[lane]);
+		}
+
+		for (int sum = 0; sum < SUMS; ++sum) {
+			for (int lane = 0; lane < LANES; ++lane) {
+				lanes[sum][lane] += values[lane][sum];
+			}
+		}
+	}
+
+	for (int sum = 0; sum < SUMS; ++sum) {
+		sums[sum] += (lanes[sum][0] + lanes[sum][1]) + (lanes[sum][2] + lanes[sum][3]);
+	}
+
+	for (; i < count; ++i) {
+		accumulate(x[i], y[i], z[i], 1.0);
+	}
+
+	n += count;
+}
+
+// As for circles, the normal equations in centred coordinates are
+//
+//		M * d = mr / 2,		radius^2 = |d|^2 + trace(M)
+//
+// where M is the 3x3 covariance of the points, mr_a is the mean of X_a * (X^2 + Y^2 + Z^2) and d is the offset of the
+// centre from the mean.  M is solved by Cholesky factorization
+bool SphereMoments::solve(FittedSphere& sphere) const {
+	if (n < 4) {
+		return false;
+	}
+
+	double count = static_cast<double>(n);
+
+	double mean[3];
+	for (int a = 0; a < 3; ++a) {
+		mean[a] = sums[1 + a] / count;
+	}
+
+	// Centred second moments, and centred third moments sum_b X_a * X_b^2
+	double M[3][3];
+	double mr[3]{ 0.0, 0.0, 0.0 };
+	for (int a = 0; a < 3; ++a) {
+		for (int b = 0; b < 3; ++b) {
+			M[a][b] = sums[second(a, b)] / count - mean[a] * mean[b];
+
+			mr[a] +=
+				sums[third(a, b)] / count -
+				mean[a] * sums[second(b, b)] / count -
+				2.0 * mean[b] * sums[second(a, b)] / count +
+				2.0 * mean[a] * mean[b] * mean[b];
+		}
+	}
+
+	const double EPSILON{ 0.00001 };
+
+	// Note that the tests below also catch NaN
+	double l11 = sqrt(M[0][0]);
+	if (!(l11 >= EPSILON)) {
+		return false;
+	}
+
+	double l21 = M[1][0] / l11;
+	double l31 = M[2][0] / l11;
+
+	double l22 = sqrt(M[1][1] - l21 * l21);
+	if (!(l22 >= EPSILON)) {
+		return false;
+	}
+
+	double l32 = (M[2][1] - l31 * l21) / l22;
+
+	double l33 = sqrt(M[2][2] - l31 * l31 - l32 * l32);
+	if (!(l33 >= EPSILON)) {
+		return false;
+	}
+
+	// Forward and back substitution
+	double y1 = mr[0] / 2.0 / l11;
+	double y2 = (mr[1] / 2.0 - l21 * y1) / l22;
+	double y3 = (mr[2] / 2.0 - l31 * y1 - l32 * y2) / l33;
+
+	double d3 = y3 / l33;
+	double d2 = (y2 - l32 * d3) / l22;
+	double d1 = (y1 - l21 * d2 - l31 * d3) / l11;
+
+	sphere.centre[0] = shift[0] + mean[0] + d1;
+	sphere.centre[1] = shift[1] + mean[1] + d2;
+	sphere.centre[2] = shift[2] + mean[2] + d3;
+	sphere.radius = sqrt(d1 * d1 + d2 * d2 + d3 * d3 + M[0][0] + M[1][1] + M[2][2]);
+
+	return true;
+}
+
+// The centre is equidistant from all 4 points.  Relative to the first point p0, this gives the linear system
+//
+//		2 * (p_i - p0) . (centre - p0) = |p_i - p0|^2,		i = 1, 2, 3
+bool exactSphereFit(const double x[4], const double y[4], const double z[4], FittedSphere& sphere) {
+	Matrix3 A;
+	Vector3 b;
+	for (int i = 0; i < 3; ++i) {
+		double dx = x[i + 1] - x[0];
+		double dy = y[i + 1] - y[0];
+		double dz = z[i + 1] - z[0];
+
+		A(i, 0) = 2.0 * dx;
+		A(i, 1) = 2.0 * dy;
+		A(i, 2) = 2.0 * dz;
+		b(i, 0) = dx * dx + dy * dy + dz * dz;
+	}
+
+	Matrix3 AInverse;
+	if (!inverse(A, AInverse)) {
+		return false;
+	}
+
+	Vector3 offset = AInverse * b;
+
+	sphere.centre[0] = x[0] + offset(0, 0);
+	sphere.centre[1] = y[0] + offset(1, 0);
+	sphere.centre[2] = z[0] + offset(2, 0);
+	sphere.radius = sqrt(offset(0, 0) * offset(0, 0) + offset(1, 0) * offset(1, 0) + offset(2, 0) * offset(2, 0));
+
+	return true;
+}
+
+size_t fitSpheres(const double* x, const double* y, const double* z, const size_t* offsets, size_t numberOfSets,
+	FittedSphere* spheres)
+{
+	size_t found{ 0 };
+	for (size_t set = 0; set < numberOfSets; ++set) {
+		size_t first = offsets[set];
+		size_t count = offsets[set + 1] - first;
+
+		bool ok;
+		if (count == 4) {
+			ok = exactSphereFit(x + first, y + first, z + first, spheres[set]);
+		} else {
+			SphereMoments moments;
+			moments.add(x + first, y + first, z + first, count);
+			ok = moments.solve(spheres[set]);
+		}
+
+		if (ok) {
+			++found;
+		} else {
+			spheres[set].radius = std::nan("");
+		}
+	}
+
+	return found;
+}
@@ -0,0 +1,57 @@
+#ifndef __SPHERE_MOMENTS_H__
+#define __SPHERE_MOMENTS_H__
+// Kasa's fit generalized to spheres.
+// As with CircleMoments, points can be added and removed one at a time (O(1) each), so a fit can follow an incremental
+// selection.  Batches of points are accumulated in a single pass over separate x, y and z arrays (structure of arrays).
+// Moments are accumulated relative to the first point added, to limit cancellation
+
+#include <cstddef>
+#include <cstdint>
+
+struct FittedSphere {
+	double centre[3];
+	double radius;
+};
+
+class SphereMoments {
+public:
+	SphereMoments() { clear(); }
+
+	void clear();
+
+	void add(double x, double y, double z);
+	void remove(double x, double y, double z);
+
+	// Batch version of add
+	void add(const double* x, const double* y, const double* z, size_t count);
+
+	int64_t count() const { return n; }
+
+	// Least squares sphere, minimizing sum [(x-a)^2 + (y-b)^2 + (z-c)^2 - R^2]^2
+	// Returns false if there are fewer than 4 points, or the points are on a plane
+	bool solve(FittedSphere& sphere) const;
+
+	// Number of sums: count, 3 first, 6 second and 9 third order (x_a * x_b^2) moments
+	static const int SUMS{ 19 };
+
+private:
+	void accumulate(double x, double y, double z, double sign);
+
+	int64_t n;
+	double shift[3];
+
+	// Index 0 is the count (as a double, for the batch lanes); see monomials for the order of the others
+	double sums[SUMS];
+};
+
+// The sphere through 4 points (the 3D analogue of Part_2::computeAccurateFit)
+// Returns false if the points are on a plane
+bool exactSphereFit(const double x[4], const double y[4], const double z[4], FittedSphere& sphere);
+
+// Fits a sphere to each of numberOfSets point sets.  Set i is points [offsets[i], offsets[i + 1]) of the x, y and z arrays.
+// Sets of exactly 4 points use the exact fit.  The radius of a set that doesn't define a sphere is NaN.
+// Returns the number of spheres found
+size_t fitSpheres(const double* x, const double* y, const double* z, const size_t* offsets, size_t numberOfSets,
+	FittedSphere* spheres);
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef __SPSC_RING_H__
+#define __SPSC_RING_H__
+// A lock-free ring buffer for exactly one producer thread and one consumer thread.
+// The capacity is fixed (rounded up to a power of 2), so memory is bounded; push fails when the ring is full
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+template <typename T>
+class SpscRing {
+public:
+	explicit SpscRing(size_t capacity) {
+		size_t size{ 1 };
+		while (size < capacity) {
+			size <<= 1;
+		}
+
+		buffer.resize(size);
+		mask = size - 1;
+	}
+
+	size_t capacity() const { return buffer.size(); }
+
+	// Producer only
+	bool push(const T& value) {
+		size_t tail = _tail.load(std::memory_order_relaxed);
+		if (tail - _head.load(std::memory_order_acquire) == buffer.size()) {
+			return false;
+		}
+
+		buffer[tail & mask] = value;
+		_tail.store(tail + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	// Consumer only
+	bool pop(T& value) {
+		size_t head = _head.load(std::memory_order_relaxed);
+		if (head == _tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		value = buffer[head & mask];
+		_head.store(head + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	size_t size() const {
+		return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+	}
+
+private:
+	std::vector<T> buffer;
+	size_t mask;
+
+	// The indices only ever increase (wrapping is harmless, as the capacity is a power of 2).
+	// They are kept on separate cache lines, so the producer and consumer don't invalidate each other's line
+	std::atomic<size_t> _head{ 0 };
+	char padding[64];
+	std::atomic<size_t> _tail{ 0 };
+};
+
+#endif
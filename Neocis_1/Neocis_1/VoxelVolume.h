@@ -0,0 +1,60 @@
+#ifndef __VOXEL_VOLUME_H__
+#define __VOXEL_VOLUME_H__
+// A bit-packed volume of voxels, one bit per voxel.
+// Each row (the voxels along x, for one y and z) starts on a new 64 bit word, so threads working on different rows
+// (or slices) never write to the same word
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+class VoxelVolume {
+public:
+	VoxelVolume(int width = 0, int height = 0, int depth = 0) { resize(width, height, depth); }
+
+	// Resizing clears all voxels
+	void resize(int width, int height, int depth) {
+		_width  = width;
+		_height = height;
+		_depth  = depth;
+
+		_wordsPerRow = (static_cast<size_t>(width) + 63) / 64;
+		data.assign(_wordsPerRow * height * depth, 0);
+	}
+
+	int width()  const { return _width; }
+	int height() const { return _height; }
+	int depth()  const { return _depth; }
+
+	void clear() { std::fill(data.begin(), data.end(), 0); }
+
+	void set(int x, int y, int z)        { row(y, z)[x >> 6] |= (uint64_t{ 1 } << (x & 63)); }
+	bool test(int x, int y, int z) const { return (row(y, z)[x >> 6] >> (x & 63)) & 1; }
+
+	size_t count() const {
+		size_t result{ 0 };
+		for (auto word : data) {
+			result += std::bitset<64>(word).count();
+		}
+
+		return result;
+	}
+
+	size_t wordsPerRow() const { return _wordsPerRow; }
+
+	uint64_t* row(int y, int z) { return data.data() + (static_cast<size_t>(z) * _height + y) * _wordsPerRow; }
+	const uint64_t* row(int y, int z) const { return data.data() + (static_cast<size_t>(z) * _height + y) * _wordsPerRow; }
+
+	size_t bytes() const { return data.size() * sizeof(uint64_t); }
+
+private:
+	int _width;
+	int _height;
+	int _depth;
+
+	size_t _wordsPerRow;
+	std::vector<uint64_t> data;
+};
+
+#endif
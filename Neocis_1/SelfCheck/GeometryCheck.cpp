@@ -0,0 +1,148 @@
+// Self-check of the volumetric code (ellipsoid shells and sphere fits), which has no callers in the application yet.
+// It only needs a C++14 compiler (no Qt); see "Self-check" in docs/Neocis_1.md.  Returns the number of failed checks
+
+#include <cmath>
+#include <cstdio>
+
+#include "../Neocis_1/EllipsoidShell.h"
+#include "../Neocis_1/SphereMoments.h"
+
+static int failures{ 0 };
+
+static void check(bool condition, const char* description) {
+	std::printf("%s: %s\n", condition ? "pass" : "FAIL", description);
+	if (!condition) {
+		++failures;
+	}
+}
+
+// Rotation about z by angleZ, then about x by angleX
+static Matrix3 rotation(double angleZ, double angleX) {
+	Matrix3 z = Matrix3::identity();
+	z(0, 0) = cos(angleZ);	z(0, 1) = -sin(angleZ);
+	z(1, 0) = sin(angleZ);	z(1, 1) =  cos(angleZ);
+
+	Matrix3 x = Matrix3::identity();
+	x(1, 1) = cos(angleX);	x(1, 2) = -sin(angleX);
+	x(2, 1) = sin(angleX);	x(2, 2) =  cos(angleX);
+
+	return x * z;
+}
+
+// A rotated ellipsoid marked with 1 thread and with several threads must give the same voxels, and every marked voxel
+// must be within a voxel of the surface
+static void checkEllipsoidShell() {
+	const int SIZE{ 96 };
+
+	Ellipsoid ellipsoid{ { 47.3, 45.8, 48.1 }, { 40.0, 25.0, 15.0 }, rotation(0.5, 0.3) };
+
+	VoxelVolume single(SIZE, SIZE, SIZE);
+	EllipsoidShell(1.0, 1.0, 1.0, 1).mark(ellipsoid, single);
+
+	VoxelVolume parallel(SIZE, SIZE, SIZE);
+	EllipsoidShell(1.0, 1.0, 1.0, 4).mark(ellipsoid, parallel);
+
+	bool same{ true };
+	for (int z = 0; z < SIZE; ++z) {
+		for (int y = 0; y < SIZE; ++y) {
+			for (size_t word = 0; word < single.wordsPerRow(); ++word) {
+				same = same && single.row(y, z)[word] == parallel.row(y, z)[word];
+			}
+		}
+	}
+
+	check(single.count() > 0, "ellipsoid marks voxels");
+	check(same, "ellipsoid marked with 1 and 4 threads is the same");
+
+	EllipsoidShells singleShells;
+	EllipsoidShells parallelShells;
+	check(EllipsoidShell(1.0, 1.0, 1.0, 1).shells(ellipsoid, single, singleShells) &&
+		EllipsoidShell(1.0, 1.0, 1.0, 4).shells(ellipsoid, parallel, parallelShells), "shells found");
+
+	check(singleShells.markedVoxels == single.count() && parallelShells.markedVoxels == single.count(), "shells count the marked voxels");
+
+	// A voxel is at most half a diagonal (sqrt(3) / 2) from the surface, which changes the scale by at most that over the smallest axis
+	double tolerance = 0.87 / ellipsoid.axes[2];
+	double scaleNear = singleShells.nearest.axes[0]  / ellipsoid.axes[0];
+	double scaleFar  = singleShells.farthest.axes[0] / ellipsoid.axes[0];
+
+	check(scaleNear <= 1.0 && scaleNear >= 1.0 - tolerance, "nearest shell is just inside the ellipsoid");
+	check(scaleFar  >= 1.0 && scaleFar  <= 1.0 + tolerance, "farthest shell is just outside the ellipsoid");
+	check(parallelShells.nearest.axes[0] == singleShells.nearest.axes[0] &&
+		parallelShells.farthest.axes[0] == singleShells.farthest.axes[0], "shells found with 1 and 4 threads are the same");
+}
+
+static bool sameSphere(const FittedSphere& sphere, double x, double y, double z, double radius) {
+	const double TOLERANCE{ 1e-6 };
+
+	return
+		fabs(sphere.centre[0] - x) < TOLERANCE &&
+		fabs(sphere.centre[1] - y) < TOLERANCE &&
+		fabs(sphere.centre[2] - z) < TOLERANCE &&
+		fabs(sphere.radius - radius) < TOLERANCE;
+}
+
+// Points on a known sphere must give back that sphere, from the batch and incremental fits, the exact 4 point fit and
+// fitSpheres; points on a plane must be rejected
+static void checkSphereFits() {
+	const double CENTRE[3]{ 1000.5, -250.25, 75.0 };
+	const double RADIUS{ 12.5 };
+	const int COUNT{ 200 };
+
+	double x[COUNT];
+	double y[COUNT];
+	double z[COUNT];
+	for (int i = 0; i < COUNT; ++i) {
+		// Points spread over the sphere (a spiral from pole to pole)
+		double height = 1.0 - 2.0 * (i + 0.5) / COUNT;
+		double ring = sqrt(1.0 - height * height);
+		double angle = 2.39996 * i;
+
+		x[i] = CENTRE[0] + RADIUS * ring * cos(angle);
+		y[i] = CENTRE[1] + RADIUS * ring * sin(angle);
+		z[i] = CENTRE[2] + RADIUS * height;
+	}
+
+	FittedSphere sphere;
+
+	SphereMoments batch;
+	batch.add(x, y, z, COUNT);
+	check(batch.solve(sphere) && sameSphere(sphere, CENTRE[0], CENTRE[1], CENTRE[2], RADIUS), "batch sphere fit");
+
+	// Adding points one at a time, and removing some, must give the same sphere
+	SphereMoments incremental;
+	for (int i = 0; i < COUNT; ++i) {
+		incremental.add(x[i], y[i], z[i]);
+	}
+
+	for (int i = 0; i < COUNT; i += 3) {
+		incremental.remove(x[i], y[i], z[i]);
+	}
+
+	check(incremental.solve(sphere) && sameSphere(sphere, CENTRE[0], CENTRE[1], CENTRE[2], RADIUS), "incremental sphere fit");
+
+	const int FIRST{ 7 };
+	check(exactSphereFit(x + FIRST, y + FIRST, z + FIRST, sphere) && sameSphere(sphere, CENTRE[0], CENTRE[1], CENTRE[2], RADIUS),
+		"exact 4 point sphere fit");
+
+	const double flat[4]{ 0.0, 0.0, 0.0, 0.0 };
+	check(!exactSphereFit(x, y, flat, sphere), "exact fit rejects points on a plane");
+
+	// Sets of 4 points (exact fit), 3 points (no sphere) and the rest of the points (least squares)
+	const size_t offsets[4]{ 0, 4, 7, COUNT };
+	FittedSphere spheres[3];
+	size_t found = fitSpheres(x, y, z, offsets, 3, spheres);
+
+	check(found == 2 &&
+		sameSphere(spheres[0], CENTRE[0], CENTRE[1], CENTRE[2], RADIUS) &&
+		std::isnan(spheres[1].radius) &&
+		sameSphere(spheres[2], CENTRE[0], CENTRE[1], CENTRE[2], RADIUS), "fitSpheres");
+}
+
+int main() {
+	checkEllipsoidShell();
+	checkSphereFits();
+
+	std::printf("%d failed\n", failures);
+	return failures;
+}